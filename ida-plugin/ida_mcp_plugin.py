@@ -161,25 +161,31 @@ class IDADataProvider:
         return result
 
     @staticmethod
-    def list_functions(limit: int = 100) -> dict:
-        """List all functions in the binary"""
+    def list_functions(limit: int = 100, offset: int = 0) -> dict:
+        """List functions in the binary, one page at a time starting at offset"""
+        total = ida_funcs.get_func_qty()
+        offset = max(0, offset)
+        end = min(total, offset + limit) if limit else total
+
         funcs = []
-        for idx, ea in enumerate(idautils.Functions()):
-            if limit and idx >= limit:
-                break
+        for idx in range(offset, end):
+            func = ida_funcs.getn_func(idx)
+            if not func:
+                continue
+            ea = func.start_ea
             name = ida_name.get_name(ea) or f"sub_{ea:X}"
-            func = ida_funcs.get_func(ea)
-            size = func.end_ea - func.start_ea if func else 0
             funcs.append({
                 "address": f"0x{ea:X}",
                 "name": name,
-                "size": size
+                "size": func.end_ea - func.start_ea
             })
 
         return {
             "functions": funcs,
-            "total": len(list(idautils.Functions())),
-            "returned": len(funcs)
+            "total": total,
+            "returned": len(funcs),
+            "offset": offset,
+            "next_offset": end if end < total else None
         }
 
     @staticmethod
@@ -491,11 +497,12 @@ MCP_TOOLS = [
     },
     {
         "name": "list_functions",
-        "description": "List all functions in the binary",
+        "description": "List functions in the binary (paginated; pass next_offset back as offset for the next page)",
         "inputSchema": {
             "type": "object",
             "properties": {
-                "limit": {"type": "integer", "description": "Max functions to return"}
+                "limit": {"type": "integer", "description": "Max functions to return"},
+                "offset": {"type": "integer", "description": "Index of the first function to return"}
             }
         }
     },
@@ -587,59 +594,65 @@ MCP_TOOLS = [
 ]
 
 
+def dispatch_tool(name: str, arguments: dict) -> dict:
+    """Run a single tool. Must be called on IDA's main thread."""
+    try:
+        if name == "get_function_pseudocode":
+            return IDADataProvider.get_function_pseudocode(arguments["address"])
+        elif name == "get_function_assembly":
+            return IDADataProvider.get_function_assembly(arguments["address"])
+        elif name == "get_function_xrefs":
+            return IDADataProvider.get_function_xrefs(arguments["address"])
+        elif name == "analyze_function":
+            return IDADataProvider.analyze_function(arguments["address"])
+        elif name == "list_functions":
+            limit = arguments.get("limit", 100)
+            offset = arguments.get("offset", 0)
+            return IDADataProvider.list_functions(limit, offset)
+        elif name == "get_current_function":
+            return IDADataProvider.get_current_function()
+        elif name == "rename_function":
+            return IDADataProvider.rename_function(arguments["address"], arguments["new_name"])
+        elif name == "add_comment":
+            return IDADataProvider.add_comment(
+                arguments["address"],
+                arguments["comment"],
+                arguments.get("repeatable", False)
+            )
+        elif name == "get_database_info":
+            return IDADataProvider.get_database_info()
+        elif name == "rename_local_variable":
+            return IDADataProvider.rename_local_variable(
+                arguments["address"],
+                arguments["old_name"],
+                arguments["new_name"]
+            )
+        elif name == "set_variable_type":
+            return IDADataProvider.set_variable_type(
+                arguments["address"],
+                arguments["var_name"],
+                arguments["type_str"]
+            )
+        elif name == "add_function_comment":
+            return IDADataProvider.add_function_comment(
+                arguments["address"],
+                arguments["comment"],
+                arguments.get("line_number")
+            )
+        elif name == "get_function_local_variables":
+            return IDADataProvider.get_function_local_variables(arguments["address"])
+        else:
+            return {"error": f"Unknown tool: {name}"}
+    except Exception as e:
+        return {"error": str(e)}
+
+
 def execute_tool(name: str, arguments: dict) -> dict:
     """Execute a tool and return the result"""
     result = [None]
 
     def execute_on_main_thread():
-        try:
-            if name == "get_function_pseudocode":
-                result[0] = IDADataProvider.get_function_pseudocode(arguments["address"])
-            elif name == "get_function_assembly":
-                result[0] = IDADataProvider.get_function_assembly(arguments["address"])
-            elif name == "get_function_xrefs":
-                result[0] = IDADataProvider.get_function_xrefs(arguments["address"])
-            elif name == "analyze_function":
-                result[0] = IDADataProvider.analyze_function(arguments["address"])
-            elif name == "list_functions":
-                limit = arguments.get("limit", 100)
-                result[0] = IDADataProvider.list_functions(limit)
-            elif name == "get_current_function":
-                result[0] = IDADataProvider.get_current_function()
-            elif name == "rename_function":
-                result[0] = IDADataProvider.rename_function(arguments["address"], arguments["new_name"])
-            elif name == "add_comment":
-                result[0] = IDADataProvider.add_comment(
-                    arguments["address"],
-                    arguments["comment"],
-                    arguments.get("repeatable", False)
-                )
-            elif name == "get_database_info":
-                result[0] = IDADataProvider.get_database_info()
-            elif name == "rename_local_variable":
-                result[0] = IDADataProvider.rename_local_variable(
-                    arguments["address"],
-                    arguments["old_name"],
-                    arguments["new_name"]
-                )
-            elif name == "set_variable_type":
-                result[0] = IDADataProvider.set_variable_type(
-                    arguments["address"],
-                    arguments["var_name"],
-                    arguments["type_str"]
-                )
-            elif name == "add_function_comment":
-                result[0] = IDADataProvider.add_function_comment(
-                    arguments["address"],
-                    arguments["comment"],
-                    arguments.get("line_number")
-                )
-            elif name == "get_function_local_variables":
-                result[0] = IDADataProvider.get_function_local_variables(arguments["address"])
-            else:
-                result[0] = {"error": f"Unknown tool: {name}"}
-        except Exception as e:
-            result[0] = {"error": str(e)}
+        result[0] = dispatch_tool(name, arguments)
         return 1
 
     # Execute on main thread using IDA's execute_sync
@@ -647,24 +660,48 @@ def execute_tool(name: str, arguments: dict) -> dict:
     return result[0]
 
 
+def execute_tools_batch(calls: list) -> list:
+    """Execute several tools in one main-thread hop, returning results in call order"""
+    results = []
+
+    def execute_on_main_thread():
+        for call in calls:
+            if not isinstance(call, dict) or not call.get("name"):
+                results.append({"error": "Missing tool name"})
+                continue
+            results.append(dispatch_tool(call["name"], call.get("arguments", {})))
+        return 1
+
+    idaapi.execute_sync(execute_on_main_thread, idaapi.MFF_FAST)
+    return results
+
+
 class IDAHTTPHandler(http.server.BaseHTTPRequestHandler):
     """HTTP request handler for IDA MCP bridge"""
 
+    # HTTP/1.1 keeps the socket open between requests so clients can pool connections
+    protocol_version = "HTTP/1.1"
+    # Drop idle keep-alive connections so handler threads don't pile up
+    timeout = 60
+
     def log_message(self, format, *args):
         print(f"[IDA-MCP] {args[0]}")
 
     def send_json(self, data: dict, status: int = 200):
+        body = json.dumps(data).encode()
         self.send_response(status)
         self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(body)))
         self.send_header("Access-Control-Allow-Origin", "*")
         self.end_headers()
-        self.wfile.write(json.dumps(data).encode())
+        self.wfile.write(body)
 
     def do_OPTIONS(self):
         self.send_response(200)
         self.send_header("Access-Control-Allow-Origin", "*")
         self.send_header("Access-Control-Allow-Methods", "GET, POST, OPTIONS")
         self.send_header("Access-Control-Allow-Headers", "Content-Type")
+        self.send_header("Content-Length", "0")
         self.end_headers()
 
     def do_GET(self):
@@ -702,6 +739,15 @@ class IDAHTTPHandler(http.server.BaseHTTPRequestHandler):
             result = execute_tool(tool_name, arguments)
             self.send_json({"result": result})
 
+        elif path == "/batch":
+            calls = data.get("calls")
+
+            if not isinstance(calls, list):
+                self.send_json({"error": "Missing calls array"}, 400)
+                return
+
+            self.send_json({"results": execute_tools_batch(calls)})
+
         else:
             self.send_json({"error": "Not found"}, 404)
 
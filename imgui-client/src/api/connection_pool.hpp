@@ -0,0 +1,240 @@
+#pragma once
+
+namespace ida_re::api {
+    struct connection_stats_t {
+        std::uint64_t m_requests { 0 };
+        std::uint64_t m_failures { 0 };
+        std::uint64_t m_opened { 0 };
+        std::uint64_t m_reused { 0 };
+        std::uint64_t m_evicted { 0 };
+        double        m_total_ms { 0.0 };
+        double        m_last_ms { 0.0 };
+        double        m_max_ms { 0.0 };
+
+        [[nodiscard]] double average_ms( ) const noexcept {
+            return m_requests ? m_total_ms / static_cast< double >( m_requests ) : 0.0;
+        }
+    };
+
+    // Bounded pool of keep-alive HTTP clients. A client object owns one socket and is not safe
+    // for concurrent requests, so callers lease one for the duration of a round trip.
+    template < typename client_t >
+    class c_connection_pool {
+      public:
+        using clock_t   = std::chrono::steady_clock;
+        using factory_t = std::function< std::unique_ptr< client_t >( ) >;
+
+        class lease_t {
+          public:
+            lease_t( ) = default;
+
+            lease_t( c_connection_pool *pool, std::unique_ptr< client_t > client, std::uint64_t generation, bool reused ) noexcept
+                : m_pool( pool ), m_client( std::move( client ) ), m_generation( generation ), m_reused( reused ) { }
+
+            lease_t( lease_t &&other ) noexcept
+                : m_pool( std::exchange( other.m_pool, nullptr ) ), m_client( std::move( other.m_client ) ),
+                  m_generation( other.m_generation ), m_reused( other.m_reused ) { }
+
+            lease_t &operator=( lease_t &&other ) noexcept {
+                if ( this != &other ) {
+                    release( );
+                    m_pool       = std::exchange( other.m_pool, nullptr );
+                    m_client     = std::move( other.m_client );
+                    m_generation = other.m_generation;
+                    m_reused     = other.m_reused;
+                }
+                return *this;
+            }
+
+            lease_t( const lease_t & )            = delete;
+            lease_t &operator=( const lease_t & ) = delete;
+
+            ~lease_t( ) {
+                release( );
+            }
+
+            [[nodiscard]] client_t *operator->( ) const noexcept {
+                return m_client.get( );
+            }
+
+            [[nodiscard]] client_t &operator*( ) const noexcept {
+                return *m_client;
+            }
+
+            [[nodiscard]] explicit operator bool( ) const noexcept {
+                return m_client != nullptr;
+            }
+
+            // true when the socket came from the idle list rather than a fresh connect
+            [[nodiscard]] bool reused( ) const noexcept {
+                return m_reused;
+            }
+
+            // drop the connection instead of returning it (broken socket, server went away)
+            void discard( ) noexcept {
+                m_client.reset( );
+            }
+
+          private:
+            void release( ) noexcept {
+                if ( m_pool ) {
+                    m_pool->give_back( std::move( m_client ), m_generation );
+                    m_pool = nullptr;
+                }
+            }
+
+            c_connection_pool          *m_pool { nullptr };
+            std::unique_ptr< client_t > m_client { };
+            std::uint64_t               m_generation { 0 };
+            bool                        m_reused { false };
+        };
+
+        c_connection_pool( ) = default;
+
+        c_connection_pool( const c_connection_pool & )            = delete;
+        c_connection_pool &operator=( const c_connection_pool & ) = delete;
+
+        void set_factory( factory_t factory ) {
+            std::lock_guard< std::mutex > lock( m_mutex );
+            m_factory = std::move( factory );
+            m_open -= m_idle.size( );
+            m_idle.clear( );
+            ++m_generation;
+        }
+
+        void set_max_size( std::size_t size ) {
+            {
+                std::lock_guard< std::mutex > lock( m_mutex );
+                m_max_size = std::max< std::size_t >( size, 1 );
+                if ( m_idle.size( ) > m_max_size ) {
+                    const auto excess = m_idle.size( ) - m_max_size;
+                    m_idle.erase( m_idle.begin( ), m_idle.begin( ) + static_cast< std::ptrdiff_t >( excess ) );
+                    m_open -= excess;
+                }
+            }
+            m_cv.notify_all( );
+        }
+
+        void set_idle_timeout( std::chrono::seconds timeout ) {
+            std::lock_guard< std::mutex > lock( m_mutex );
+            m_idle_timeout = timeout;
+        }
+
+        [[nodiscard]] std::size_t max_size( ) const {
+            std::lock_guard< std::mutex > lock( m_mutex );
+            return m_max_size;
+        }
+
+        // Returns an idle connection (most recently used first) or opens a new one.
+        // Blocks while max_size connections are already leased out.
+        [[nodiscard]] lease_t acquire( ) {
+            std::unique_lock< std::mutex > lock( m_mutex );
+
+            evict_idle( clock_t::now( ) );
+            m_cv.wait( lock, [ this ] { return !m_idle.empty( ) || m_open < m_max_size; } );
+
+            if ( !m_idle.empty( ) ) {
+                auto client = std::move( m_idle.back( ).m_client );
+                m_idle.pop_back( );
+                ++m_stats.m_reused;
+                return lease_t( this, std::move( client ), m_generation, true );
+            }
+
+            if ( !m_factory ) {
+                return { };
+            }
+
+            ++m_open;
+            ++m_stats.m_opened;
+            auto       factory    = m_factory;
+            const auto generation = m_generation;
+            lock.unlock( );
+
+            auto client = factory( );
+            if ( !client ) {
+                give_back( nullptr, generation );
+                return { };
+            }
+
+            return lease_t( this, std::move( client ), generation, false );
+        }
+
+        // Closes every idle connection; leased ones are dropped when they come back
+        void clear( ) {
+            {
+                std::lock_guard< std::mutex > lock( m_mutex );
+                m_open -= m_idle.size( );
+                m_idle.clear( );
+                ++m_generation;
+            }
+            m_cv.notify_all( );
+        }
+
+        void record( std::chrono::microseconds latency, bool success ) {
+            const auto ms = static_cast< double >( latency.count( ) ) / 1000.0;
+
+            std::lock_guard< std::mutex > lock( m_mutex );
+            ++m_stats.m_requests;
+            if ( !success ) {
+                ++m_stats.m_failures;
+            }
+            m_stats.m_total_ms += ms;
+            m_stats.m_last_ms = ms;
+            m_stats.m_max_ms  = std::max( m_stats.m_max_ms, ms );
+        }
+
+        [[nodiscard]] connection_stats_t stats( ) const {
+            std::lock_guard< std::mutex > lock( m_mutex );
+            return m_stats;
+        }
+
+        void reset_stats( ) {
+            std::lock_guard< std::mutex > lock( m_mutex );
+            m_stats = { };
+        }
+
+      private:
+        struct idle_t {
+            std::unique_ptr< client_t > m_client { };
+            clock_t::time_point         m_last_used { };
+        };
+
+        // connections leased before the last clear() belong to a stale host/port and are closed
+        void give_back( std::unique_ptr< client_t > client, std::uint64_t generation ) noexcept {
+            {
+                std::lock_guard< std::mutex > lock( m_mutex );
+                if ( client && generation == m_generation && m_idle.size( ) < m_max_size ) {
+                    m_idle.push_back( { std::move( client ), clock_t::now( ) } );
+                } else {
+                    --m_open;
+                }
+            }
+            m_cv.notify_one( );
+        }
+
+        // caller holds m_mutex; idle list is ordered oldest -> newest
+        void evict_idle( clock_t::time_point now ) {
+            auto it = m_idle.begin( );
+            while ( it != m_idle.end( ) && now - it->m_last_used > m_idle_timeout ) {
+                ++it;
+            }
+
+            const auto count = static_cast< std::size_t >( std::distance( m_idle.begin( ), it ) );
+            if ( count ) {
+                m_idle.erase( m_idle.begin( ), it );
+                m_open -= count;
+                m_stats.m_evicted += count;
+            }
+        }
+
+        mutable std::mutex      m_mutex { };
+        std::condition_variable m_cv { };
+        factory_t               m_factory { };
+        std::vector< idle_t >   m_idle { };
+        std::size_t             m_open { 0 };
+        std::size_t             m_max_size { 4 };
+        std::chrono::seconds    m_idle_timeout { 30 };
+        std::uint64_t           m_generation { 0 };
+        connection_stats_t      m_stats { };
+    };
+} // namespace ida_re::api
@@ -1,10 +1,379 @@
 #include "vendor.hpp"
 
 #include "llm_api.hpp"
+#include "sse_parser.hpp"
 #include <httplib.h>
 
 namespace ida_re::api {
+    namespace {
+        // Runs request on a pooled keep-alive TLS connection, so only the first call to a host pays for the
+        // TCP and TLS handshakes. A reused socket the server has already closed fails before anything is
+        // read; that case is retried once on a fresh connection, unless a streamed response has started.
+        template < typename request_fn_t >
+        httplib::Result round_trip( c_connection_pool< httplib::SSLClient > &pool, request_fn_t &&request,
+                                    const bool *delivered = nullptr ) {
+            httplib::Result res;
+
+            for ( int attempt = 0; attempt < 2; ++attempt ) {
+                auto lease = pool.acquire( );
+                if ( !lease ) {
+                    break;
+                }
+
+                const auto start = std::chrono::steady_clock::now( );
+                res              = request( *lease );
+                pool.record( std::chrono::duration_cast< std::chrono::microseconds >( std::chrono::steady_clock::now( ) - start ),
+                             static_cast< bool >( res ) );
+
+                if ( res ) {
+                    break;
+                }
+
+                // a failed or cancelled exchange leaves the socket in an unknown state
+                lease.discard( );
+                if ( !lease.reused( ) || res.error( ) == httplib::Error::Read || res.error( ) == httplib::Error::Canceled
+                     || ( delivered && *delivered ) ) {
+                    break;
+                }
+            }
+
+            return res;
+        }
+
+        // only this much of a streamed body is kept, to report errors that arrive as plain JSON instead of events
+        constexpr std::size_t k_stream_error_body_limit = 4096;
+
+        std::string string_or( const json_t &object, const char *key, const std::string &fallback ) {
+            const auto it = object.find( key );
+            return it != object.end( ) && it->is_string( ) ? it->get< std::string >( ) : fallback;
+        }
+
+        int int_or( const json_t &object, const char *key, int fallback ) {
+            const auto it = object.find( key );
+            return it != object.end( ) && it->is_number_integer( ) ? it->get< int >( ) : fallback;
+        }
+
+        // Anthropic reports cached prompt tokens next to input_tokens, not inside it
+        void read_claude_usage( const json_t &usage, token_usage_t &out ) {
+            out.m_input       = int_or( usage, "input_tokens", out.m_input );
+            out.m_output      = int_or( usage, "output_tokens", out.m_output );
+            out.m_cache_read  = int_or( usage, "cache_read_input_tokens", out.m_cache_read );
+            out.m_cache_write = int_or( usage, "cache_creation_input_tokens", out.m_cache_write );
+        }
+
+        // OpenAI and OpenRouter count automatically cached tokens inside prompt_tokens
+        void read_chat_completion_usage( const json_t &usage, token_usage_t &out ) {
+            const int prompt = int_or( usage, "prompt_tokens", out.prompt( ) );
+            out.m_output     = int_or( usage, "completion_tokens", out.m_output );
+
+            const auto details = usage.find( "prompt_tokens_details" );
+            if ( details != usage.end( ) && details->is_object( ) )
+                out.m_cache_read = int_or( *details, "cached_tokens", out.m_cache_read );
+
+            out.m_input = prompt - out.m_cache_read;
+        }
+
+        // Gemini likewise includes context-cache hits in promptTokenCount
+        void read_gemini_usage( const json_t &usage, token_usage_t &out ) {
+            const int prompt = int_or( usage, "promptTokenCount", out.prompt( ) );
+            out.m_output     = int_or( usage, "candidatesTokenCount", out.m_output );
+            out.m_cache_read = int_or( usage, "cachedContentTokenCount", out.m_cache_read );
+            out.m_input      = prompt - out.m_cache_read;
+        }
+
+        // pulls the text delta out of one parsed stream event and records whatever metadata (model, usage,
+        // finish reason) the event carries; providers differ only here
+        using delta_extractor_t = std::string ( * )( const json_t &payload, response_t &resp );
+
+        std::string claude_delta( const json_t &payload, response_t &resp ) {
+            const auto type = string_or( payload, "type", "" );
+
+            if ( type == "message_start" && payload.contains( "message" ) ) {
+                const auto &message = payload[ "message" ];
+                resp.m_model        = string_or( message, "model", resp.m_model );
+                if ( message.contains( "usage" ) )
+                    read_claude_usage( message[ "usage" ], resp.m_usage );
+                return { };
+            }
+
+            if ( type == "message_delta" ) {
+                if ( payload.contains( "delta" ) )
+                    resp.m_finish_reason = string_or( payload[ "delta" ], "stop_reason", resp.m_finish_reason );
+                if ( payload.contains( "usage" ) )
+                    read_claude_usage( payload[ "usage" ], resp.m_usage );
+                return { };
+            }
+
+            if ( type != "content_block_delta" || !payload.contains( "delta" ) )
+                return { };
+
+            const auto &delta = payload[ "delta" ];
+            return string_or( delta, "type", "" ) == "text_delta" ? string_or( delta, "text", "" ) : std::string { };
+        }
+
+        // OpenAI and OpenRouter share the chat completions chunk format; usage comes in a final chunk
+        // with no choices when the request asked for it
+        std::string chat_completion_delta( const json_t &payload, response_t &resp ) {
+            resp.m_model = string_or( payload, "model", resp.m_model );
+
+            if ( payload.contains( "usage" ) && payload[ "usage" ].is_object( ) )
+                read_chat_completion_usage( payload[ "usage" ], resp.m_usage );
+
+            if ( !payload.contains( "choices" ) || payload[ "choices" ].empty( ) )
+                return { };
+
+            const auto &choice   = payload[ "choices" ][ 0 ];
+            resp.m_finish_reason = string_or( choice, "finish_reason", resp.m_finish_reason );
+
+            if ( !choice.contains( "delta" ) )
+                return { };
+
+            return string_or( choice[ "delta" ], "content", "" );
+        }
+
+        std::string gemini_delta( const json_t &payload, response_t &resp ) {
+            std::string text;
+
+            if ( payload.contains( "usageMetadata" ) )
+                read_gemini_usage( payload[ "usageMetadata" ], resp.m_usage );
+
+            if ( !payload.contains( "candidates" ) || payload[ "candidates" ].empty( ) )
+                return text;
+
+            const auto &candidate = payload[ "candidates" ][ 0 ];
+            resp.m_finish_reason  = string_or( candidate, "finishReason", resp.m_finish_reason );
+
+            if ( candidate.contains( "content" ) && candidate[ "content" ].contains( "parts" ) ) {
+                for ( const auto &part : candidate[ "content" ][ "parts" ] ) {
+                    text += string_or( part, "text", "" );
+                }
+            }
+            return text;
+        }
+
+        // a text content block ending a cached prefix; everything up to and including it is reused by the
+        // next request with the same prefix, which then bills those tokens as cache reads
+        json_t cached_text_block( const std::string &text ) {
+            return {
+                {          "type",                            "text" },
+                {          "text",                              text },
+                { "cache_control", { { "type", "ephemeral" } } }
+            };
+        }
+
+        // error bodies look like {"error":{"message":...}}; Gemini's stream endpoint wraps that in an array
+        std::string http_error_message( int status, const std::string &body ) {
+            try {
+                auto err = json_t::parse( body );
+                if ( err.is_array( ) && !err.empty( ) )
+                    err = err[ 0 ];
+                if ( err.contains( "error" ) && err[ "error" ].contains( "message" ) )
+                    return err[ "error" ][ "message" ].get< std::string >( );
+            } catch ( ... ) { }
+
+            return body.empty( ) ? "HTTP " + std::to_string( status ) : body;
+        }
+
+        // POSTs a streaming request and feeds the text/event-stream response through one c_sse_parser,
+        // handing every non-empty text delta to cb (when set) and accumulating the full reply, usage and
+        // finish reason into the returned response. run( request, delivered ) performs the exchange with
+        // the client's throttling and retries; state is polled for cancellation per received chunk and
+        // its m_received follows the reply.
+        template < typename run_fn_t >
+        response_t stream_sse( run_fn_t &&run, const std::string &path, const httplib::Headers &headers, const std::string &payload,
+                               const char *content_type, e_provider provider, const std::string &model, delta_extractor_t extract,
+                               const stream_callback_t &cb, request_state_t &state ) {
+            response_t resp;
+            resp.m_provider = provider;
+            resp.m_model    = model;
+
+            c_sse_parser parser;
+            std::string  head;
+            bool         delivered = false; // text reached cb; the request can no longer be retried
+
+            const c_sse_parser::event_callback_t on_event = [ & ]( const sse_event_t &event ) {
+                if ( event.m_data == "[DONE]" )
+                    return;
+
+                try {
+                    const auto text = extract( json_t::parse( event.m_data.begin( ), event.m_data.end( ) ), resp );
+                    if ( text.empty( ) )
+                        return;
+
+                    delivered       = true;
+                    resp.m_content += text;
+                    state.m_received.fetch_add( text.size( ), std::memory_order_relaxed );
+                    if ( cb )
+                        cb( text );
+                } catch ( ... ) { }
+            };
+
+            auto result = run(
+                [ & ]( httplib::SSLClient &client ) {
+                    // a retried attempt starts from a clean slate; nothing of the failed one reached cb
+                    parser.reset( );
+                    head.clear( );
+                    resp.m_usage         = { };
+                    resp.m_finish_reason = { };
+                    state.m_received.store( 0, std::memory_order_relaxed );
+
+                    return client.Post( path, headers, payload, content_type, [ & ]( const char *data, size_t len ) -> bool {
+                        if ( state.cancelled( ) )
+                            return false;
+
+                        if ( head.size( ) < k_stream_error_body_limit )
+                            head.append( data, std::min( len, k_stream_error_body_limit - head.size( ) ) );
+
+                        parser.feed( std::string_view( data, len ), on_event );
+                        return true;
+                    } );
+                },
+                &delivered );
+
+            parser.finish( on_event );
+
+            if ( !result ) {
+                resp.m_error = state.cancelled( ) ? "Cancelled" : "Request failed: " + httplib::to_string( result.error( ) );
+                return resp;
+            }
+
+            if ( result->status != 200 ) {
+                resp.m_content.clear( );
+                resp.m_error = http_error_message( result->status, head );
+                return resp;
+            }
+
+            resp.m_success = true;
+            return resp;
+        }
+
+        // statuses worth another attempt: throttled, overloaded (Anthropic's 529) or a transient gateway failure
+        bool is_retryable_status( int status ) noexcept {
+            return status == 429 || status == 500 || status == 502 || status == 503 || status == 504 || status == 529;
+        }
+
+        // retry-after-ms (OpenAI) or Retry-After in delta-seconds; the HTTP-date form is not used by these APIs
+        std::optional< std::chrono::milliseconds > retry_after( const httplib::Response &response ) {
+            if ( response.has_header( "retry-after-ms" ) ) {
+                const double ms = std::strtod( response.get_header_value( "retry-after-ms" ).c_str( ), nullptr );
+                if ( ms > 0.0 )
+                    return std::chrono::milliseconds( static_cast< long long >( ms ) );
+            }
+
+            if ( response.has_header( "Retry-After" ) ) {
+                const double seconds = std::strtod( response.get_header_value( "Retry-After" ).c_str( ), nullptr );
+                if ( seconds > 0.0 )
+                    return std::chrono::milliseconds( static_cast< long long >( seconds * 1000.0 ) );
+            }
+
+            return std::nullopt;
+        }
+
+        // Calls fn( i ) for every i below count, in order of i, on up to max_threads threads (the caller's among
+        // them). No further i is handed out once fn returns false.
+        void run_in_parallel( std::size_t count, std::size_t max_threads, const std::function< bool( std::size_t ) > &fn ) {
+            std::atomic< std::size_t > next { 0 };
+            std::atomic< bool >        stop { false };
+
+            const auto worker = [ & ] {
+                for ( std::size_t i; !stop.load( ) && ( i = next.fetch_add( 1 ) ) < count; ) {
+                    if ( !fn( i ) )
+                        stop.store( true );
+                }
+            };
+
+            std::vector< std::thread > workers;
+            for ( std::size_t i = 1; i < std::min( max_threads, count ); i++ ) {
+                workers.emplace_back( worker );
+            }
+            worker( );
+            for ( auto &thread : workers ) {
+                thread.join( );
+            }
+        }
+
+        // "Part 3" or "Parts 3-5"; parts are numbered from 1
+        std::string part_label( std::size_t first, std::size_t last ) {
+            if ( first == last )
+                return "Part " + std::to_string( first + 1 );
+            return "Parts " + std::to_string( first + 1 ) + "-" + std::to_string( last + 1 );
+        }
+    } // namespace
+
+    request_handle_t make_request( request_handle_t parent ) {
+        static std::atomic< std::uint64_t > next_id { 1 };
+
+        auto state      = std::make_shared< request_state_t >( );
+        state->m_id     = next_id.fetch_add( 1, std::memory_order_relaxed );
+        state->m_parent = std::move( parent );
+        return state;
+    }
+
+    template < typename Derived >
+    template < typename request_fn_t >
+    httplib::Result c_client_base< Derived >::execute( std::size_t tokens, const guard_t &guard, request_fn_t &&request,
+                                                       const bool *delivered ) {
+        // never wait longer than this on one Retry-After; past it the user is better served by the error
+        constexpr auto k_max_retry_after = std::chrono::seconds( 60 );
+
+        int max_retries;
+        {
+            const std::lock_guard< std::mutex > lk( m_mutex );
+            max_retries = m_config.m_max_retries;
+        }
+
+        const auto cancelled = [ &guard ] { return guard.cancelled( ); };
+
+        for ( int retry = 0;; retry++ ) {
+            // the limiter only looks at cancelled( ) while it has to wait
+            if ( cancelled( ) || !m_limiter.acquire( tokens, cancelled ) )
+                return httplib::Result( nullptr, httplib::Error::Canceled );
+
+            auto result = round_trip( m_pool, request, delivered );
+
+            const bool failed = result ? is_retryable_status( result->status ) : result.error( ) != httplib::Error::Canceled;
+            if ( !failed || guard.cancelled( ) || ( delivered && *delivered ) || retry >= max_retries || !m_limiter.take_retry( ) )
+                return result;
+
+            auto delay = std::chrono::duration_cast< std::chrono::milliseconds >( m_limiter.backoff( retry ) );
+            if ( result ) {
+                if ( const auto hint = retry_after( result.value( ) ) ) {
+                    if ( *hint > k_max_retry_after )
+                        return result;
+                    delay = *hint;
+                }
+            }
+
+            // throttling and overload concern every request to the provider, so all of them hold back;
+            // the limiter wait at the top of the loop then covers this request too
+            m_limiter.pause_for( delay );
+        }
+    }
+
+    template < typename Derived >
+    void c_client_base< Derived >::use_host( const std::string &host ) {
+        const std::lock_guard< std::mutex > lk( m_mutex );
+        if ( m_pool_host == host )
+            return;
+
+        m_pool_host = host;
+        m_pool.set_factory( [ host ] {
+            auto client = std::make_unique< httplib::SSLClient >( host, 443 );
+            client->set_connection_timeout( 30 );
+            client->set_read_timeout( 120 );
+            client->set_keep_alive( true );
+            client->set_tcp_nodelay( true );
+            return client;
+        } );
+    }
+
     // ==================== Claude ====================
+
+    c_claude::c_claude( ) {
+        m_config.m_model = "claude-sonnet-4-5-20250929";
+    }
+
+    c_claude::~c_claude( ) = default;
     std::vector< model_t > c_claude::models( ) {
         return {
             { "claude-sonnet-4-5-20250929", "Claude Sonnet 4.5", e_provider::claude, 200000, true },
@@ -14,12 +383,20 @@ namespace ida_re::api {
         };
     }
 
-    json_t c_claude::make_body( const std::vector< message_t > &msgs, bool stream ) const {
+    json_t c_claude::make_body( const client_config_t &cfg, const std::vector< message_t > &msgs, bool stream ) const {
         json_t messages        = json_t::array( );
         auto   non_system_msgs = msgs | std::views::filter( []( const auto &m ) {
                                    return m.m_role != "system";
                                } );
         for ( const auto &m : non_system_msgs ) {
+            if ( cfg.m_prompt_caching && m.m_cache ) {
+                messages.push_back( {
+                    {    "role",                                  m.m_role },
+                    { "content", json_t::array( { cached_text_block( m.m_content ) } ) }
+                } );
+                continue;
+            }
+
             messages.push_back( {
                 {    "role",    m.m_role },
                 { "content", m.m_content }
@@ -27,13 +404,17 @@ namespace ida_re::api {
         }
 
         json_t body = {
-            {      "model",      m_config.m_model },
-            { "max_tokens", m_config.m_max_tokens },
+            {      "model",      cfg.m_model },
+            { "max_tokens", cfg.m_max_tokens },
             {   "messages",              messages }
         };
 
-        if ( !m_config.m_system_prompt.empty( ) ) {
-            body[ "system" ] = m_config.m_system_prompt;
+        if ( !cfg.m_system_prompt.empty( ) ) {
+            if ( cfg.m_prompt_caching ) {
+                body[ "system" ] = json_t::array( { cached_text_block( cfg.m_system_prompt ) } );
+            } else {
+                body[ "system" ] = cfg.m_system_prompt;
+            }
         }
 
         if ( stream ) {
@@ -47,18 +428,16 @@ namespace ida_re::api {
         return send( std::vector< message_t > { message_t::user( message ) } );
     }
 
-    response_t c_claude::send( const std::vector< message_t > &messages ) {
-        auto cfg = snapshot( );
-        return request( make_body( messages, false ) );
+    response_t c_claude::send( const std::vector< message_t > &messages, const request_handle_t &handle ) {
+        return finished( handle, request( make_body( snapshot( ), messages, false ), handle ) );
     }
 
-    void c_claude::stream( std::string_view message, stream_callback_t cb ) {
-        stream( std::vector< message_t > { message_t::user( message ) }, cb );
+    response_t c_claude::stream( std::string_view message, stream_callback_t cb ) {
+        return stream( std::vector< message_t > { message_t::user( message ) }, cb );
     }
 
-    void c_claude::stream( const std::vector< message_t > &messages, stream_callback_t cb ) {
-        auto cfg = snapshot( );
-        stream_request( make_body( messages, true ), cb );
+    response_t c_claude::stream( const std::vector< message_t > &messages, stream_callback_t cb, const request_handle_t &handle ) {
+        return finished( handle, stream_request( make_body( snapshot( ), messages, true ), cb, handle ) );
     }
 
     std::string c_claude::sanitize_host( std::string_view base_url ) const {
@@ -93,8 +472,8 @@ namespace ida_re::api {
         return url.empty( ) ? "api.anthropic.com" : url;
     }
 
-    response_t c_claude::request( const json_t &body ) {
-        guard_t    guard( m_busy, m_cancel );
+    response_t c_claude::request( const json_t &body, const request_handle_t &handle ) {
+        guard_t    guard( *this, handle );
         response_t resp;
         resp.m_provider = e_provider::claude;
 
@@ -104,18 +483,18 @@ namespace ida_re::api {
             return resp;
         }
 
-        std::string host = sanitize_host( cfg.m_base_url );
-        httplib::SSLClient client( host, 443 );
-        client.set_connection_timeout( 30 );
-        client.set_read_timeout( 120 );
+        use_host( sanitize_host( cfg.m_base_url ) );
 
         httplib::Headers headers = {
             {         "x-api-key",        cfg.m_api_key },
             { "anthropic-version",         "2023-06-01" },
-            {      "content-type", "application/json_t" }
+            {      "content-type", "application/json" }
         };
 
-        auto result = client.Post( "/v1/messages", headers, body.dump( ), "application/json_t" );
+        const auto payload = body.dump( );
+        auto       result  = execute( estimate_tokens( payload ), guard, [ & ]( httplib::SSLClient &client ) {
+            return client.Post( "/v1/messages", headers, payload, "application/json" );
+        } );
 
         if ( !result ) {
             resp.m_error = "Request failed: " + httplib::to_string( result.error( ) );
@@ -148,8 +527,7 @@ namespace ida_re::api {
             }
 
             if ( j.contains( "usage" ) ) {
-                resp.m_usage.m_input  = j[ "usage" ].value( "input_tokens", 0 );
-                resp.m_usage.m_output = j[ "usage" ].value( "output_tokens", 0 );
+                read_claude_usage( j[ "usage" ], resp.m_usage );
             }
 
             resp.m_model         = j.value( "model", cfg.m_model );
@@ -163,62 +541,41 @@ namespace ida_re::api {
         return resp;
     }
 
-    void c_claude::stream_request( const json_t &body, stream_callback_t cb ) {
-        guard_t guard( m_busy, m_cancel );
+    response_t c_claude::stream_request( const json_t &body, stream_callback_t cb, const request_handle_t &handle ) {
+        guard_t guard( *this, handle );
 
         auto cfg = snapshot( );
-        if ( cfg.m_api_key.empty( ) || !cb )
-            return;
+        if ( cfg.m_api_key.empty( ) ) {
+            response_t resp;
+            resp.m_provider = e_provider::claude;
+            resp.m_error    = "API key not set";
+            return resp;
+        }
 
-        std::string host = sanitize_host( cfg.m_base_url );
-        httplib::SSLClient client( host, 443 );
-        client.set_connection_timeout( 30 );
-        client.set_read_timeout( 120 );
+        use_host( sanitize_host( cfg.m_base_url ) );
 
         httplib::Headers headers = {
             {         "x-api-key",        cfg.m_api_key },
             { "anthropic-version",         "2023-06-01" },
-            {      "content-type", "application/json_t" }
+            {      "content-type", "application/json" }
         };
 
-        std::string buffer;
-
-        client.Post( "/v1/messages", headers, body.dump( ), "application/json_t", [ & ]( const char *data, size_t len ) -> bool {
-            if ( guard.cancelled( ) )
-                return false;
-
-            buffer.append( data, len );
-
-            size_t pos;
-            while ( ( pos = buffer.find( '\n' ) ) != std::string::npos ) {
-                std::string line = buffer.substr( 0, pos );
-                buffer.erase( 0, pos + 1 );
+        const auto payload = body.dump( );
+        const auto run     = [ & ]( auto &&request, const bool *delivered ) {
+            return execute( estimate_tokens( payload ), guard, request, delivered );
+        };
 
-                if ( line.empty( ) || line[ 0 ] == ':' )
-                    continue;
+        return stream_sse( run, "/v1/messages", headers, payload, "application/json", e_provider::claude, cfg.m_model,
+                           claude_delta, cb, *guard.state );
+    }
 
-                if ( line.rfind( "data: ", 0 ) == 0 ) {
-                    std::string json_t_str = line.substr( 6 );
-                    if ( json_t_str == "[DONE]" )
-                        continue;
+    // ==================== OpenAI ====================
 
-                    try {
-                        auto j = json_t::parse( json_t_str );
-                        if ( j.value( "type", "" ) == "content_block_delta" ) {
-                            if ( j.contains( "delta" ) && j[ "delta" ].value( "type", "" ) == "text_delta" ) {
-                                std::string text = j[ "delta" ].value( "text", "" );
-                                if ( !text.empty( ) )
-                                    cb( text );
-                            }
-                        }
-                    } catch ( ... ) { }
-                }
-            }
-            return true;
-        } );
+    c_openai::c_openai( ) {
+        m_config.m_model = "gpt-4o";
     }
 
-    // ==================== OpenAI ====================
+    c_openai::~c_openai( ) = default;
 
     std::vector< model_t > c_openai::models( ) {
         return {
@@ -260,13 +617,13 @@ namespace ida_re::api {
         return url.empty( ) ? "api.openai.com" : url;
     }
 
-    json_t c_openai::make_body( const std::vector< message_t > &msgs, bool stream ) const {
+    json_t c_openai::make_body( const client_config_t &cfg, const std::vector< message_t > &msgs, bool stream ) const {
         json_t messages = json_t::array( );
 
-        if ( !m_config.m_system_prompt.empty( ) ) {
+        if ( !cfg.m_system_prompt.empty( ) ) {
             messages.push_back( {
                 {    "role",                 "system" },
-                { "content", m_config.m_system_prompt }
+                { "content", cfg.m_system_prompt }
             } );
         }
 
@@ -278,13 +635,17 @@ namespace ida_re::api {
         }
 
         json_t body = {
-            {      "model",      m_config.m_model },
-            { "max_tokens", m_config.m_max_tokens },
+            {      "model",      cfg.m_model },
+            { "max_tokens", cfg.m_max_tokens },
             {   "messages",              messages }
         };
 
         if ( stream ) {
             body[ "stream" ] = true;
+            // otherwise streamed completions carry no token counts
+            body[ "stream_options" ] = {
+                { "include_usage", true }
+            };
         }
 
         return body;
@@ -294,22 +655,20 @@ namespace ida_re::api {
         return send( std::vector< message_t > { message_t::user( message ) } );
     }
 
-    response_t c_openai::send( const std::vector< message_t > &messages ) {
-        auto cfg = snapshot( );
-        return request( make_body( messages, false ) );
+    response_t c_openai::send( const std::vector< message_t > &messages, const request_handle_t &handle ) {
+        return finished( handle, request( make_body( snapshot( ), messages, false ), handle ) );
     }
 
-    void c_openai::stream( std::string_view message, stream_callback_t cb ) {
-        stream( std::vector< message_t > { message_t::user( message ) }, cb );
+    response_t c_openai::stream( std::string_view message, stream_callback_t cb ) {
+        return stream( std::vector< message_t > { message_t::user( message ) }, cb );
     }
 
-    void c_openai::stream( const std::vector< message_t > &messages, stream_callback_t cb ) {
-        auto cfg = snapshot( );
-        stream_request( make_body( messages, true ), cb );
+    response_t c_openai::stream( const std::vector< message_t > &messages, stream_callback_t cb, const request_handle_t &handle ) {
+        return finished( handle, stream_request( make_body( snapshot( ), messages, true ), cb, handle ) );
     }
 
-    response_t c_openai::request( const json_t &body ) {
-        guard_t    guard( m_busy, m_cancel );
+    response_t c_openai::request( const json_t &body, const request_handle_t &handle ) {
+        guard_t    guard( *this, handle );
         response_t resp;
         resp.m_provider = e_provider::openai;
 
@@ -319,17 +678,17 @@ namespace ida_re::api {
             return resp;
         }
 
-        std::string host = sanitize_host( cfg.m_base_url );
-        httplib::SSLClient client( host, 443 );
-        client.set_connection_timeout( 30 );
-        client.set_read_timeout( 120 );
+        use_host( sanitize_host( cfg.m_base_url ) );
 
         httplib::Headers headers = {
             { "Authorization", "Bearer " + cfg.m_api_key },
-            {  "content-type",      "application/json_t" }
+            {  "content-type",      "application/json" }
         };
 
-        auto result = client.Post( "/v1/chat/completions", headers, body.dump( ), "application/json_t" );
+        const auto payload = body.dump( );
+        auto       result  = execute( estimate_tokens( payload ), guard, [ & ]( httplib::SSLClient &client ) {
+            return client.Post( "/v1/chat/completions", headers, payload, "application/json" );
+        } );
 
         if ( !result ) {
             resp.m_error = "Request failed: " + httplib::to_string( result.error( ) );
@@ -361,9 +720,8 @@ namespace ida_re::api {
                 resp.m_finish_reason = choice.value( "finish_reason", "" );
             }
 
-            if ( j.contains( "usage" ) ) {
-                resp.m_usage.m_input  = j[ "usage" ].value( "prompt_tokens", 0 );
-                resp.m_usage.m_output = j[ "usage" ].value( "completion_tokens", 0 );
+            if ( j.contains( "usage" ) && j[ "usage" ].is_object( ) ) {
+                read_chat_completion_usage( j[ "usage" ], resp.m_usage );
             }
 
             resp.m_model   = j.value( "model", cfg.m_model );
@@ -376,62 +734,40 @@ namespace ida_re::api {
         return resp;
     }
 
-    void c_openai::stream_request( const json_t &body, stream_callback_t cb ) {
-        guard_t guard( m_busy, m_cancel );
+    response_t c_openai::stream_request( const json_t &body, stream_callback_t cb, const request_handle_t &handle ) {
+        guard_t guard( *this, handle );
 
         auto cfg = snapshot( );
-        if ( cfg.m_api_key.empty( ) || !cb )
-            return;
+        if ( cfg.m_api_key.empty( ) ) {
+            response_t resp;
+            resp.m_provider = e_provider::openai;
+            resp.m_error    = "API key not set";
+            return resp;
+        }
 
-        std::string host = sanitize_host( cfg.m_base_url );
-        httplib::SSLClient client( host, 443 );
-        client.set_connection_timeout( 30 );
-        client.set_read_timeout( 120 );
+        use_host( sanitize_host( cfg.m_base_url ) );
 
         httplib::Headers headers = {
             { "Authorization", "Bearer " + cfg.m_api_key },
-            {  "content-type",      "application/json_t" }
+            {  "content-type",      "application/json" }
         };
 
-        std::string buffer;
-
-        client.Post( "/v1/chat/completions", headers, body.dump( ), "application/json_t", [ & ]( const char *data, size_t len ) -> bool {
-            if ( guard.cancelled( ) )
-                return false;
-
-            buffer.append( data, len );
-
-            size_t pos;
-            while ( ( pos = buffer.find( '\n' ) ) != std::string::npos ) {
-                std::string line = buffer.substr( 0, pos );
-                buffer.erase( 0, pos + 1 );
+        const auto payload = body.dump( );
+        const auto run     = [ & ]( auto &&request, const bool *delivered ) {
+            return execute( estimate_tokens( payload ), guard, request, delivered );
+        };
 
-                if ( line.empty( ) )
-                    continue;
+        return stream_sse( run, "/v1/chat/completions", headers, payload, "application/json", e_provider::openai, cfg.m_model,
+                           chat_completion_delta, cb, *guard.state );
+    }
 
-                if ( line.rfind( "data: ", 0 ) == 0 ) {
-                    std::string json_t_str = line.substr( 6 );
-                    if ( json_t_str == "[DONE]" )
-                        continue;
+    // ==================== Gemini ====================
 
-                    try {
-                        auto j = json_t::parse( json_t_str );
-                        if ( j.contains( "choices" ) && !j[ "choices" ].empty( ) ) {
-                            auto &delta = j[ "choices" ][ 0 ][ "delta" ];
-                            if ( delta.contains( "content" ) ) {
-                                std::string text = delta[ "content" ].get< std::string >( );
-                                if ( !text.empty( ) )
-                                    cb( text );
-                            }
-                        }
-                    } catch ( ... ) { }
-                }
-            }
-            return true;
-        } );
+    c_gemini::c_gemini( ) {
+        m_config.m_model = "gemini-2.0-flash";
     }
 
-    // ==================== Gemini ====================
+    c_gemini::~c_gemini( ) = default;
 
     std::vector< model_t > c_gemini::models( ) {
         return {
@@ -443,19 +779,19 @@ namespace ida_re::api {
         };
     }
 
-    std::string c_gemini::get_url( bool stream ) const {
+    std::string c_gemini::get_url( const client_config_t &cfg, bool stream ) const {
         std::string action = stream ? "streamGenerateContent" : "generateContent";
-        return "/v1beta/models/" + m_config.m_model + ":" + action + "?key=" + m_config.m_api_key;
+        return "/v1beta/models/" + cfg.m_model + ":" + action + "?key=" + cfg.m_api_key;
     }
 
-    json_t c_gemini::make_body( const std::vector< message_t > &msgs ) const {
+    json_t c_gemini::make_body( const client_config_t &cfg, const std::vector< message_t > &msgs ) const {
         json_t contents = json_t::array( );
 
         // System instruction goes separately in Gemini API
         json_t system_instruction;
-        if ( !m_config.m_system_prompt.empty( ) ) {
+        if ( !cfg.m_system_prompt.empty( ) ) {
             system_instruction = {
-                { "parts", { { { "text", m_config.m_system_prompt } } } }
+                { "parts", { { { "text", cfg.m_system_prompt } } } }
             };
         }
 
@@ -472,7 +808,7 @@ namespace ida_re::api {
 
         json_t body = {
             {         "contents",                                                                                    contents },
-            { "generationConfig", { { "maxOutputTokens", m_config.m_max_tokens }, { "temperature", m_config.m_temperature } } }
+            { "generationConfig", { { "maxOutputTokens", cfg.m_max_tokens }, { "temperature", cfg.m_temperature } } }
         };
 
         if ( !system_instruction.is_null( ) ) {
@@ -486,20 +822,20 @@ namespace ida_re::api {
         return send( std::vector< message_t > { message_t::user( message ) } );
     }
 
-    response_t c_gemini::send( const std::vector< message_t > &messages ) {
-        return request( messages );
+    response_t c_gemini::send( const std::vector< message_t > &messages, const request_handle_t &handle ) {
+        return finished( handle, request( messages, handle ) );
     }
 
-    void c_gemini::stream( std::string_view message, stream_callback_t cb ) {
-        stream( std::vector< message_t > { message_t::user( message ) }, cb );
+    response_t c_gemini::stream( std::string_view message, stream_callback_t cb ) {
+        return stream( std::vector< message_t > { message_t::user( message ) }, cb );
     }
 
-    void c_gemini::stream( const std::vector< message_t > &messages, stream_callback_t cb ) {
-        stream_request( messages, cb );
+    response_t c_gemini::stream( const std::vector< message_t > &messages, stream_callback_t cb, const request_handle_t &handle ) {
+        return finished( handle, stream_request( messages, cb, handle ) );
     }
 
-    response_t c_gemini::request( const std::vector< message_t > &messages ) {
-        guard_t    guard( m_busy, m_cancel );
+    response_t c_gemini::request( const std::vector< message_t > &messages, const request_handle_t &handle ) {
+        guard_t    guard( *this, handle );
         response_t resp;
         resp.m_provider = e_provider::gemini;
 
@@ -509,18 +845,19 @@ namespace ida_re::api {
             return resp;
         }
 
-        httplib::SSLClient client( "generativelanguage.googleapis.com", 443 );
-        client.set_connection_timeout( 30 );
-        client.set_read_timeout( 120 );
+        use_host( "generativelanguage.googleapis.com" );
 
         httplib::Headers headers = {
-            { "content-type", "application/json_t" }
+            { "content-type", "application/json" }
         };
 
-        json_t      body = make_body( messages );
-        std::string url  = get_url( false );
+        json_t      body = make_body( cfg, messages );
+        std::string url  = get_url( cfg, false );
 
-        auto result = client.Post( url, headers, body.dump( ), "application/json_t" );
+        const auto payload = body.dump( );
+        auto       result  = execute( estimate_tokens( payload ), guard, [ & ]( httplib::SSLClient &client ) {
+            return client.Post( url, headers, payload, "application/json" );
+        } );
 
         if ( !result ) {
             resp.m_error = "Request failed: " + httplib::to_string( result.error( ) );
@@ -557,8 +894,7 @@ namespace ida_re::api {
             }
 
             if ( j.contains( "usageMetadata" ) ) {
-                resp.m_usage.m_input  = j[ "usageMetadata" ].value( "promptTokenCount", 0 );
-                resp.m_usage.m_output = j[ "usageMetadata" ].value( "candidatesTokenCount", 0 );
+                read_gemini_usage( j[ "usageMetadata" ], resp.m_usage );
             }
 
             resp.m_model   = cfg.m_model;
@@ -571,73 +907,51 @@ namespace ida_re::api {
         return resp;
     }
 
-    void c_gemini::stream_request( const std::vector< message_t > &messages, stream_callback_t cb ) {
-        guard_t guard( m_busy, m_cancel );
+    response_t c_gemini::stream_request( const std::vector< message_t > &messages, stream_callback_t cb,
+                                          const request_handle_t &handle ) {
+        guard_t guard( *this, handle );
 
         auto cfg = snapshot( );
-        if ( cfg.m_api_key.empty( ) || !cb )
-            return;
+        if ( cfg.m_api_key.empty( ) ) {
+            response_t resp;
+            resp.m_provider = e_provider::gemini;
+            resp.m_error    = "API key not set";
+            return resp;
+        }
 
-        httplib::SSLClient client( "generativelanguage.googleapis.com", 443 );
-        client.set_connection_timeout( 30 );
-        client.set_read_timeout( 120 );
+        use_host( "generativelanguage.googleapis.com" );
 
         httplib::Headers headers = {
-            { "content-type", "application/json_t" }
+            { "content-type", "application/json" }
         };
 
-        json_t      body = make_body( messages );
-        std::string url  = get_url( true ) + "&alt=sse";
-
-        std::string buffer;
-
-        client.Post( url, headers, body.dump( ), "application/json_t", [ & ]( const char *data, size_t len ) -> bool {
-            if ( guard.cancelled( ) )
-                return false;
-
-            buffer.append( data, len );
-
-            size_t pos;
-            while ( ( pos = buffer.find( '\n' ) ) != std::string::npos ) {
-                std::string line = buffer.substr( 0, pos );
-                buffer.erase( 0, pos + 1 );
-
-                if ( line.empty( ) )
-                    continue;
-
-                if ( line.rfind( "data: ", 0 ) == 0 ) {
-                    std::string json_t_str = line.substr( 6 );
-
-                    try {
-                        auto j = json_t::parse( json_t_str );
-                        if ( j.contains( "candidates" ) && !j[ "candidates" ].empty( ) ) {
-                            auto &candidate = j[ "candidates" ][ 0 ];
-                            if ( candidate.contains( "content" ) && candidate[ "content" ].contains( "parts" ) ) {
-                                for ( const auto &part : candidate[ "content" ][ "parts" ] ) {
-                                    if ( part.contains( "text" ) ) {
-                                        std::string text = part[ "text" ].get< std::string >( );
-                                        if ( !text.empty( ) )
-                                            cb( text );
-                                    }
-                                }
-                            }
-                        }
-                    } catch ( ... ) { }
-                }
-            }
-            return true;
-        } );
+        json_t      body = make_body( cfg, messages );
+        std::string url  = get_url( cfg, true ) + "&alt=sse";
+
+        const auto payload = body.dump( );
+        const auto run     = [ & ]( auto &&request, const bool *delivered ) {
+            return execute( estimate_tokens( payload ), guard, request, delivered );
+        };
+
+        return stream_sse( run, url, headers, payload, "application/json", e_provider::gemini, cfg.m_model, gemini_delta, cb,
+                           *guard.state );
     }
 
     // ==================== OpenRouter ====================
 
-    json_t c_openrouter::make_body( const std::vector< message_t > &msgs, bool stream ) const {
+    c_openrouter::c_openrouter( ) {
+        m_config.m_model = "mistralai/devstral-small:free";
+    }
+
+    c_openrouter::~c_openrouter( ) = default;
+
+    json_t c_openrouter::make_body( const client_config_t &cfg, const std::vector< message_t > &msgs, bool stream ) const {
         json_t messages = json_t::array( );
 
-        if ( !m_config.m_system_prompt.empty( ) ) {
+        if ( !cfg.m_system_prompt.empty( ) ) {
             messages.push_back( {
                 {    "role",                 "system" },
-                { "content", m_config.m_system_prompt }
+                { "content", cfg.m_system_prompt }
             } );
         }
 
@@ -649,8 +963,8 @@ namespace ida_re::api {
         }
 
         json_t body = {
-            {      "model",      m_config.m_model },
-            { "max_tokens", m_config.m_max_tokens },
+            {      "model",      cfg.m_model },
+            { "max_tokens", cfg.m_max_tokens },
             {   "messages",              messages }
         };
 
@@ -665,20 +979,20 @@ namespace ida_re::api {
         return send( std::vector< message_t > { message_t::user( message ) } );
     }
 
-    response_t c_openrouter::send( const std::vector< message_t > &messages ) {
-        return request( make_body( messages, false ) );
+    response_t c_openrouter::send( const std::vector< message_t > &messages, const request_handle_t &handle ) {
+        return finished( handle, request( make_body( snapshot( ), messages, false ), handle ) );
     }
 
-    void c_openrouter::stream( std::string_view message, stream_callback_t cb ) {
-        stream( std::vector< message_t > { message_t::user( message ) }, cb );
+    response_t c_openrouter::stream( std::string_view message, stream_callback_t cb ) {
+        return stream( std::vector< message_t > { message_t::user( message ) }, cb );
     }
 
-    void c_openrouter::stream( const std::vector< message_t > &messages, stream_callback_t cb ) {
-        stream_request( make_body( messages, true ), cb );
+    response_t c_openrouter::stream( const std::vector< message_t > &messages, stream_callback_t cb, const request_handle_t &handle ) {
+        return finished( handle, stream_request( make_body( snapshot( ), messages, true ), cb, handle ) );
     }
 
-    response_t c_openrouter::request( const json_t &body ) {
-        guard_t    guard( m_busy, m_cancel );
+    response_t c_openrouter::request( const json_t &body, const request_handle_t &handle ) {
+        guard_t    guard( *this, handle );
         response_t resp;
         resp.m_provider = e_provider::openrouter;
 
@@ -688,9 +1002,7 @@ namespace ida_re::api {
             return resp;
         }
 
-        httplib::SSLClient client( "openrouter.ai", 443 );
-        client.set_connection_timeout( 30 );
-        client.set_read_timeout( 120 );
+        use_host( "openrouter.ai" );
 
         httplib::Headers headers = {
             { "Authorization", "Bearer " + cfg.m_api_key },
@@ -699,7 +1011,10 @@ namespace ida_re::api {
             {    "X-Title",                "IDA RE Assistant" }
         };
 
-        auto result = client.Post( "/api/v1/chat/completions", headers, body.dump( ), "application/json" );
+        const auto payload = body.dump( );
+        auto       result  = execute( estimate_tokens( payload ), guard, [ & ]( httplib::SSLClient &client ) {
+            return client.Post( "/api/v1/chat/completions", headers, payload, "application/json" );
+        } );
 
         if ( !result ) {
             resp.m_error = "Request failed: " + httplib::to_string( result.error( ) );
@@ -731,9 +1046,8 @@ namespace ida_re::api {
                 resp.m_finish_reason = choice.value( "finish_reason", "" );
             }
 
-            if ( j.contains( "usage" ) ) {
-                resp.m_usage.m_input  = j[ "usage" ].value( "prompt_tokens", 0 );
-                resp.m_usage.m_output = j[ "usage" ].value( "completion_tokens", 0 );
+            if ( j.contains( "usage" ) && j[ "usage" ].is_object( ) ) {
+                read_chat_completion_usage( j[ "usage" ], resp.m_usage );
             }
 
             resp.m_model   = j.value( "model", cfg.m_model );
@@ -746,16 +1060,18 @@ namespace ida_re::api {
         return resp;
     }
 
-    void c_openrouter::stream_request( const json_t &body, stream_callback_t cb ) {
-        guard_t guard( m_busy, m_cancel );
+    response_t c_openrouter::stream_request( const json_t &body, stream_callback_t cb, const request_handle_t &handle ) {
+        guard_t guard( *this, handle );
 
         auto cfg = snapshot( );
-        if ( cfg.m_api_key.empty( ) || !cb )
-            return;
+        if ( cfg.m_api_key.empty( ) ) {
+            response_t resp;
+            resp.m_provider = e_provider::openrouter;
+            resp.m_error    = "API key not set";
+            return resp;
+        }
 
-        httplib::SSLClient client( "openrouter.ai", 443 );
-        client.set_connection_timeout( 30 );
-        client.set_read_timeout( 120 );
+        use_host( "openrouter.ai" );
 
         httplib::Headers headers = {
             { "Authorization", "Bearer " + cfg.m_api_key },
@@ -764,46 +1080,18 @@ namespace ida_re::api {
             {    "X-Title",                "IDA RE Assistant" }
         };
 
-        std::string buffer;
-
-        client.Post( "/api/v1/chat/completions", headers, body.dump( ), "application/json", [ & ]( const char *data, size_t len ) -> bool {
-            if ( guard.cancelled( ) )
-                return false;
-
-            buffer.append( data, len );
-
-            size_t pos;
-            while ( ( pos = buffer.find( '\n' ) ) != std::string::npos ) {
-                std::string line = buffer.substr( 0, pos );
-                buffer.erase( 0, pos + 1 );
-
-                if ( line.empty( ) )
-                    continue;
-
-                if ( line.rfind( "data: ", 0 ) == 0 ) {
-                    std::string json_str = line.substr( 6 );
-                    if ( json_str == "[DONE]" )
-                        continue;
+        const auto payload = body.dump( );
+        const auto run     = [ & ]( auto &&request, const bool *delivered ) {
+            return execute( estimate_tokens( payload ), guard, request, delivered );
+        };
 
-                    try {
-                        auto j = json_t::parse( json_str );
-                        if ( j.contains( "choices" ) && !j[ "choices" ].empty( ) ) {
-                            auto &delta = j[ "choices" ][ 0 ][ "delta" ];
-                            if ( delta.contains( "content" ) ) {
-                                std::string text = delta[ "content" ].get< std::string >( );
-                                if ( !text.empty( ) )
-                                    cb( text );
-                            }
-                        }
-                    } catch ( ... ) { }
-                }
-            }
-            return true;
-        } );
+        return stream_sse( run, "/api/v1/chat/completions", headers, payload, "application/json", e_provider::openrouter,
+                           cfg.m_model, chat_completion_delta, cb, *guard.state );
     }
 
     std::vector< model_t > c_openrouter::parse_models_response( const json_t &data ) {
-        std::vector< model_t > models;
+        std::vector< model_t >                 models;
+        std::unordered_map< std::string, int > context_windows;
 
         if ( !data.contains( "data" ) || !data[ "data" ].is_array( ) )
             return models;
@@ -816,11 +1104,14 @@ namespace ida_re::api {
             if ( id.empty( ) )
                 continue;
 
+            // every model's window is kept, so a configured model hidden by the free filter still gets its limit
+            context_windows[ id ] = ctx;
+
             // Check if free model (ends with :free)
             bool is_free = id.ends_with( ":free" );
 
             // Filter by free_only setting
-            if ( m_show_free_only && !is_free )
+            if ( show_free_only( ) && !is_free )
                 continue;
 
             models.push_back( {
@@ -832,6 +1123,11 @@ namespace ida_re::api {
             } );
         }
 
+        {
+            const std::lock_guard< std::mutex > lk( m_mutex );
+            m_context_windows = std::move( context_windows );
+        }
+
         // Sort: free models first, then by name
         std::ranges::sort( models, []( const model_t &a, const model_t &b ) {
             bool a_free = a.m_id.ends_with( ":free" );
@@ -848,77 +1144,284 @@ namespace ida_re::api {
         auto now = std::chrono::steady_clock::now( );
 
         // Return cached if valid
-        if ( !force_refresh && !m_cached_models.empty( ) && ( now - m_models_fetched_at ) < k_cache_duration ) {
-            return m_cached_models;
+        {
+            const std::lock_guard< std::mutex > lk( m_mutex );
+            if ( !force_refresh && !m_cached_models.empty( ) && ( now - m_models_fetched_at ) < k_cache_duration ) {
+                return m_cached_models;
+            }
         }
 
-        httplib::SSLClient client( "openrouter.ai", 443 );
-        client.set_connection_timeout( 15 );
-        client.set_read_timeout( 30 );
-
-        auto result = client.Get( "/api/v1/models" );
+        // the lock is not held over the round trip, so requests and the UI are not stalled behind it
+        use_host( "openrouter.ai" );
+        auto result = round_trip( m_pool, []( httplib::SSLClient &client ) { return client.Get( "/api/v1/models" ); } );
 
         if ( !result || result->status != 200 ) {
             // Return cached on error
-            return m_cached_models;
+            return cached_models( );
         }
 
         try {
-            auto data        = json_t::parse( result->body );
-            m_cached_models  = parse_models_response( data );
+            auto data   = json_t::parse( result->body );
+            auto models = parse_models_response( data );
+
+            const std::lock_guard< std::mutex > lk( m_mutex );
+            m_cached_models     = std::move( models );
             m_models_fetched_at = now;
         } catch ( ... ) {
             // Keep cached on parse error
         }
 
-        return m_cached_models;
+        return cached_models( );
     }
 
     // ==================== Manager ====================
 
+    c_llm_manager::~c_llm_manager( ) {
+        std::unique_lock< std::mutex > lk( m_lanes_mutex );
+        for ( const auto &lane : m_lanes ) {
+            lane->cancel( );
+        }
+        m_lanes_cv.wait( lk, [ this ] { return m_lanes.empty( ); } );
+    }
+
     response_t c_llm_manager::send( std::string_view message ) {
+        return send( std::vector< message_t > { message_t::user( message ) } );
+    }
+
+    response_t c_llm_manager::send( const std::vector< message_t > &messages, const request_handle_t &handle ) {
+        // a hedged request is streamed internally: the first token is what the race is decided on
+        if ( const auto policy = active_hedge( ) )
+            return hedged( messages, *policy, { }, handle );
+
+        const auto  trimmed = fit_to_window( m_provider, messages );
+        const auto &request = trimmed ? *trimmed : messages;
+
         switch ( m_provider ) {
             case e_provider::claude :
-                return m_claude.send( message );
+                return m_claude.send( request, handle );
             case e_provider::openai :
-                return m_openai.send( message );
+                return m_openai.send( request, handle );
             case e_provider::gemini :
-                return m_gemini.send( message );
+                return m_gemini.send( request, handle );
             case e_provider::openrouter :
-                return m_openrouter.send( message );
+                return m_openrouter.send( request, handle );
         }
         return response_t { .m_error = "Unknown provider" };
     }
 
-    response_t c_llm_manager::send( const std::vector< message_t > &messages ) {
-        switch ( m_provider ) {
+    response_t c_llm_manager::stream( std::string_view message, stream_callback_t cb ) {
+        return stream( std::vector< message_t > { message_t::user( message ) }, std::move( cb ) );
+    }
+
+    response_t c_llm_manager::stream( const std::vector< message_t > &messages, stream_callback_t cb, const request_handle_t &handle ) {
+        if ( const auto policy = active_hedge( ) )
+            return hedged( messages, *policy, std::move( cb ), handle );
+
+        return dispatch( m_provider, messages, cb, handle );
+    }
+
+    response_t c_llm_manager::dispatch( e_provider provider, const std::vector< message_t > &messages, const stream_callback_t &cb,
+                                        const request_handle_t &handle ) {
+        const auto  trimmed = fit_to_window( provider, messages );
+        const auto &request = trimmed ? *trimmed : messages;
+
+        switch ( provider ) {
             case e_provider::claude :
-                return m_claude.send( messages );
+                return m_claude.stream( request, cb, handle );
             case e_provider::openai :
-                return m_openai.send( messages );
+                return m_openai.stream( request, cb, handle );
             case e_provider::gemini :
-                return m_gemini.send( messages );
+                return m_gemini.stream( request, cb, handle );
             case e_provider::openrouter :
-                return m_openrouter.send( messages );
+                return m_openrouter.stream( request, cb, handle );
         }
         return response_t { .m_error = "Unknown provider" };
     }
 
-    void c_llm_manager::stream( std::string_view message, stream_callback_t cb ) {
-        switch ( m_provider ) {
+    std::optional< hedge_policy_t > c_llm_manager::active_hedge( ) const {
+        const std::lock_guard< std::mutex > lk( m_hedge_mutex );
+        if ( !m_hedge.m_enabled || m_hedge.m_secondary == m_provider )
+            return std::nullopt;
+        return m_hedge;
+    }
+
+    response_t c_llm_manager::hedged( const std::vector< message_t > &messages, const hedge_policy_t &policy, stream_callback_t cb,
+                                      const request_handle_t &handle ) {
+        // shared with the lane threads; a cancelled loser may still be winding down after we return
+        struct race_t {
+            std::mutex                                   m_mutex { };
+            std::condition_variable                      m_cv { };
+            std::array< e_provider, 2 >                  m_providers { };
+            std::array< request_handle_t, 2 >            m_lanes { }; // children of the caller's handle
+            std::array< bool, 2 >                        m_launched { };
+            std::array< std::optional< response_t >, 2 > m_results { };
+            int                                          m_winner { -1 }; // lane that streamed text first
+        };
+
+        auto race         = std::make_shared< race_t >( );
+        race->m_providers = { m_provider, policy.m_secondary };
+        race->m_lanes     = { make_request( handle ), make_request( handle ) };
+
+        // called with race->m_mutex held
+        const auto launch = [ this, &race, &messages, &cb, &handle ]( int lane ) {
+            race->m_launched[ lane ] = true;
+            {
+                const std::lock_guard< std::mutex > lanes_lk( m_lanes_mutex );
+                m_lanes.push_back( race->m_lanes[ lane ] );
+            }
+
+            std::thread( [ this, race, lane, messages, cb, handle ]( ) {
+                const auto on_text = [ & ]( std::string_view text ) {
+                    {
+                        const std::lock_guard< std::mutex > lk( race->m_mutex );
+                        if ( race->m_winner == -1 ) {
+                            race->m_winner = lane;
+                            race->m_lanes[ 1 - lane ]->cancel( );
+                            race->m_cv.notify_all( );
+                        } else if ( race->m_winner != lane ) {
+                            return;
+                        }
+                    }
+
+                    // only the winner gets here, so cb never sees two providers' text
+                    if ( handle )
+                        handle->m_received.fetch_add( text.size( ), std::memory_order_relaxed );
+                    if ( cb )
+                        cb( text );
+                };
+
+                auto resp = dispatch( race->m_providers[ lane ], messages, on_text, race->m_lanes[ lane ] );
+                {
+                    const std::lock_guard< std::mutex > lk( race->m_mutex );
+                    race->m_results[ lane ] = std::move( resp );
+                    race->m_cv.notify_all( );
+                }
+
+                // m_lanes_mutex stays held until this thread has fully exited, so ~c_llm_manager cannot return
+                // while anything here still runs
+                std::unique_lock< std::mutex > lanes_lk( m_lanes_mutex );
+                std::erase( m_lanes, race->m_lanes[ lane ] );
+                std::notify_all_at_thread_exit( m_lanes_cv, std::move( lanes_lk ) );
+            } ).detach( );
+        };
+
+        std::unique_lock< std::mutex > lk( race->m_mutex );
+        launch( 0 );
+
+        const bool answered = race->m_cv.wait_for( lk, policy.m_first_token_deadline, [ & ] {
+            return race->m_winner != -1 || race->m_results[ 0 ].has_value( );
+        } );
+
+        // the primary is silent past the deadline, or failed before streaming anything: bring in the backup
+        if ( !answered || ( race->m_winner == -1 && !race->m_results[ 0 ]->ok( ) ) )
+            launch( 1 );
+
+        race->m_cv.wait( lk, [ & ] {
+            if ( race->m_winner != -1 )
+                return race->m_results[ race->m_winner ].has_value( );
+
+            return ( !race->m_launched[ 0 ] || race->m_results[ 0 ] ) && ( !race->m_launched[ 1 ] || race->m_results[ 1 ] );
+        } );
+
+        const auto settle = [ &handle ]( response_t &resp ) {
+            if ( handle )
+                handle->finish( resp );
+            return std::move( resp );
+        };
+
+        if ( race->m_winner != -1 )
+            return settle( *race->m_results[ race->m_winner ] );
+
+        // neither streamed text: an empty success beats an error, and a double failure reports both
+        auto &primary = *race->m_results[ 0 ];
+        if ( primary.ok( ) || !race->m_launched[ 1 ] )
+            return settle( primary );
+
+        auto &backup = *race->m_results[ 1 ];
+        if ( backup.ok( ) )
+            return settle( backup );
+
+        primary.m_error += " (backup " + std::string( to_string( policy.m_secondary ) ) + ": " + backup.m_error + ")";
+        return settle( primary );
+    }
+
+    int c_llm_manager::context_window( ) const {
+        return context_window( m_provider );
+    }
+
+    int c_llm_manager::context_window( e_provider provider ) const {
+        std::string model;
+        int         fallback = 0;
+
+        switch ( provider ) {
             case e_provider::claude :
-                m_claude.stream( message, cb );
+                model    = m_claude.get_model( );
+                fallback = 200000;
                 break;
             case e_provider::openai :
-                m_openai.stream( message, cb );
+                model    = m_openai.get_model( );
+                fallback = 128000;
                 break;
             case e_provider::gemini :
-                m_gemini.stream( message, cb );
+                model    = m_gemini.get_model( );
+                fallback = 1000000;
                 break;
             case e_provider::openrouter :
-                m_openrouter.stream( message, cb );
+                // many free OpenRouter models are small; assume little until the models list says otherwise
+                if ( const int window = m_openrouter.context_window( m_openrouter.get_model( ) ); window > 0 )
+                    return window;
+                return 32768;
+        }
+
+        for ( const auto &known : all_models( ) ) {
+            if ( known.m_id == model && known.m_context_window > 0 )
+                return known.m_context_window;
+        }
+        return fallback;
+    }
+
+    c_token_budget c_llm_manager::token_budget( ) const {
+        return token_budget( m_provider );
+    }
+
+    c_token_budget c_llm_manager::token_budget( e_provider provider ) const {
+        int         max_tokens = 4096;
+        std::string system_prompt;
+        switch ( provider ) {
+            case e_provider::claude :
+                max_tokens    = m_claude.get_max_tokens( );
+                system_prompt = m_claude.get_system_prompt( );
+                break;
+            case e_provider::openai :
+                max_tokens    = m_openai.get_max_tokens( );
+                system_prompt = m_openai.get_system_prompt( );
+                break;
+            case e_provider::gemini :
+                max_tokens    = m_gemini.get_max_tokens( );
+                system_prompt = m_gemini.get_system_prompt( );
+                break;
+            case e_provider::openrouter :
+                max_tokens    = m_openrouter.get_max_tokens( );
+                system_prompt = m_openrouter.get_system_prompt( );
                 break;
         }
+        return c_token_budget( context_window( provider ), max_tokens, system_prompt );
+    }
+
+    std::optional< std::vector< message_t > > c_llm_manager::fit_to_window( e_provider                      provider,
+                                                                             const std::vector< message_t > &messages ) const {
+        const auto budget = token_budget( provider );
+        if ( budget.fits( messages ) )
+            return std::nullopt;
+
+        auto trimmed = messages;
+        budget.fit( trimmed );
+        return trimmed;
+    }
+
+    response_t c_llm_manager::send_or_stream( std::string_view prompt, stream_callback_t cb, const request_handle_t &handle ) {
+        const std::vector< message_t > messages { message_t::user( prompt ) };
+        return cb ? stream( messages, std::move( cb ), handle ) : send( messages, handle );
     }
 
     std::vector< model_t > c_llm_manager::all_models( ) const {
@@ -931,31 +1434,199 @@ namespace ida_re::api {
         return claude_models;
     }
 
-    response_t c_llm_manager::analyze_code( std::string_view code, std::string_view custom_prompt ) {
-        std::string prompt;
-        if ( custom_prompt.empty( ) ) {
-            prompt  = "Analyze this decompiled code:\n"
-                      "1. What does the function do?\n"
-                      "2. Key variables and their purpose\n"
-                      "3. Suspicious or interesting patterns\n"
-                      "4. Suggested names for variables/functions\n\n"
-                      "```c\n";
-            prompt += code;
-            prompt += "\n```";
-        } else {
-            prompt = std::string( custom_prompt ) + "\n\n```c\n" + std::string( code ) + "\n```";
+    std::string c_llm_manager::prompt_identity( ) const {
+        std::string model;
+        std::string system_prompt;
+
+        switch ( m_provider ) {
+            case e_provider::claude :
+                model         = m_claude.get_model( );
+                system_prompt = m_claude.get_system_prompt( );
+                break;
+            case e_provider::openai :
+                model         = m_openai.get_model( );
+                system_prompt = m_openai.get_system_prompt( );
+                break;
+            case e_provider::gemini :
+                model         = m_gemini.get_model( );
+                system_prompt = m_gemini.get_system_prompt( );
+                break;
+            case e_provider::openrouter :
+                model         = m_openrouter.get_model( );
+                system_prompt = m_openrouter.get_system_prompt( );
+                break;
         }
-        return send( prompt );
+
+        std::string identity  = std::string( to_string( m_provider ) ) + '\n' + model + '\n' + std::to_string( k_prompt_revision ) + '\n';
+        identity             += system_prompt;
+        return identity;
     }
 
-    response_t c_llm_manager::explain_function( std::string_view pseudocode ) {
-        std::string prompt  = "Explain what this function does. Be concise.\n\n```c\n";
-        prompt             += pseudocode;
+    response_t c_llm_manager::ask_about_code( std::string_view task, std::string_view code, stream_callback_t cb,
+                                              const request_handle_t &handle ) {
+        std::string prompt  = std::string( task ) + "\n\n```c\n";
+        prompt             += code;
         prompt             += "\n```";
-        return send( prompt );
+
+        if ( const auto budget = token_budget( ); !budget.fits( prompt ) )
+            return map_reduce( task, code, budget, std::move( cb ), handle );
+
+        return send_or_stream( prompt, std::move( cb ), handle );
+    }
+
+    response_t c_llm_manager::map_reduce( std::string_view task, std::string_view code, const c_token_budget &budget, stream_callback_t cb,
+                                          const request_handle_t &handle ) {
+        // room for the instructions around each piece
+        constexpr std::size_t k_chunk_prompt_reserve = 512;
+
+        // a description of consecutive parts of the function, by index into chunks
+        struct summary_t {
+            std::size_t m_first { 0 };
+            std::size_t m_last { 0 };
+            std::string m_text { };
+        };
+
+        const auto chunk_tokens = budget.prompt_budget( ) > k_chunk_prompt_reserve * 2 ? budget.prompt_budget( ) - k_chunk_prompt_reserve
+                                                                                       : budget.prompt_budget( ) / 2;
+        const auto chunks       = c_token_budget::split( code, chunk_tokens );
+        const auto total        = std::to_string( chunks.size( ) );
+
+        token_usage_t               usage;
+        std::optional< e_provider > backup; // a part answered by a hedge backup instead of primary
+        std::mutex                  usage_mutex;
+        const e_provider            primary = m_provider;
+
+        // every request but the last runs on a child of handle, so cancelling handle stops the whole job
+        const auto ask = [ & ]( const std::string &prompt, std::string &out ) {
+            auto resp = send( { message_t::user( prompt ) }, make_request( handle ) );
+            {
+                const std::lock_guard< std::mutex > lk( usage_mutex );
+                usage += resp.m_usage;
+                if ( resp.ok( ) && resp.m_provider != primary )
+                    backup = resp.m_provider;
+            }
+
+            out = std::move( resp.m_content );
+            return resp.ok( ) ? std::string( ) : resp.m_error.empty( ) ? std::string( "Request failed" ) : resp.m_error;
+        };
+
+        const auto fail = [ & ]( std::string error ) {
+            response_t resp { .m_error = handle && handle->cancelled( ) ? std::string( "Cancelled" ) : std::move( error ) };
+            resp.m_usage = usage;
+            if ( handle )
+                handle->finish( resp );
+            return resp;
+        };
+
+        std::vector< summary_t >   summaries( chunks.size( ) );
+        std::vector< std::string > errors( chunks.size( ) );
+
+        run_in_parallel( chunks.size( ), k_max_parallel_chunks, [ & ]( std::size_t i ) {
+            std::string prompt  = "This is part " + std::to_string( i + 1 ) + " of " + total
+                               + " of one large decompiled function, split at statement boundaries. The overall task is:\n\n";
+            prompt             += task;
+            prompt             += "\n\nDescribe what this part does, the variables, calls and constants it relies on, and "
+                                  "anything relevant to the task. Do not guess about code you cannot see.\n\n```c\n";
+            prompt             += chunks[ i ];
+            prompt             += "\n```";
+
+            summaries[ i ] = { i, i };
+            errors[ i ]    = ask( prompt, summaries[ i ].m_text );
+            return errors[ i ].empty( );
+        } );
+
+        if ( const auto error = std::ranges::find_if( errors, []( const auto &e ) { return !e.empty( ); } ); error != errors.end( ) )
+            return fail( *error );
+
+        const auto reduce_prompt = [ & ] {
+            std::string prompt = std::string( task ) + "\n\nThe function was too large to send at once, so it was split into " + total
+                               + " consecutive parts and each part was described separately. Answer the task for the whole function "
+                                 "using these descriptions:";
+            for ( const auto &summary : summaries ) {
+                prompt += "\n\n### " + part_label( summary.m_first, summary.m_last ) + "\n\n" + summary.m_text;
+            }
+            return prompt;
+        };
+
+        // each description may be up to max_tokens long, so together they can overflow the window the final prompt
+        // needs; merge consecutive ones in groups that fit a prompt until they all fit in one
+        const auto group_reserve = k_chunk_prompt_reserve + estimate_tokens( task );
+        auto       prompt        = reduce_prompt( );
+        while ( !budget.fits( prompt ) && summaries.size( ) > 1 ) {
+            std::vector< std::pair< std::size_t, std::size_t > > groups; // [begin, end) into summaries
+            std::size_t                                          group_tokens = group_reserve;
+            for ( std::size_t i = 0; i < summaries.size( ); i++ ) {
+                const auto tokens = estimate_tokens( summaries[ i ].m_text );
+                if ( groups.empty( ) || group_tokens + tokens > budget.prompt_budget( ) ) {
+                    groups.emplace_back( i, i );
+                    group_tokens = group_reserve;
+                }
+                groups.back( ).second++;
+                group_tokens += tokens;
+            }
+
+            // no two descriptions fit one prompt: leave the rest to fit_to_window
+            if ( groups.size( ) == summaries.size( ) )
+                break;
+
+            std::vector< summary_t > merged( groups.size( ) );
+            errors.assign( groups.size( ), { } );
+
+            run_in_parallel( groups.size( ), k_max_parallel_chunks, [ & ]( std::size_t g ) {
+                const auto [ begin, end ] = groups[ g ];
+                merged[ g ]               = { summaries[ begin ].m_first, summaries[ end - 1 ].m_last };
+                if ( end - begin == 1 ) {
+                    merged[ g ].m_text = std::move( summaries[ begin ].m_text );
+                    return true;
+                }
+
+                std::string merge  = "These are descriptions of consecutive parts of one large decompiled function that was split into "
+                                  + total + " parts. The overall task is:\n\n";
+                merge             += task;
+                merge             += "\n\nCombine them into one description of " + part_label( merged[ g ].m_first, merged[ g ].m_last )
+                                  + ", keeping the variables, calls, constants and findings relevant to the task.";
+                for ( std::size_t i = begin; i < end; i++ ) {
+                    merge += "\n\n### " + part_label( summaries[ i ].m_first, summaries[ i ].m_last ) + "\n\n" + summaries[ i ].m_text;
+                }
+
+                errors[ g ] = ask( merge, merged[ g ].m_text );
+                return errors[ g ].empty( );
+            } );
+
+            if ( const auto error = std::ranges::find_if( errors, []( const auto &e ) { return !e.empty( ); } ); error != errors.end( ) )
+                return fail( *error );
+
+            summaries = std::move( merged );
+            prompt    = reduce_prompt( );
+        }
+
+        auto resp     = send_or_stream( prompt, std::move( cb ), handle );
+        resp.m_usage += usage;
+
+        // an answer built on a backup's descriptions is the backup's as much as the final request's
+        if ( backup && resp.m_provider == primary )
+            resp.m_provider = *backup;
+        return resp;
+    }
+
+    response_t c_llm_manager::analyze_code( std::string_view code, std::string_view custom_prompt, stream_callback_t cb,
+                                            const request_handle_t &handle ) {
+        if ( !custom_prompt.empty( ) )
+            return ask_about_code( custom_prompt, code, std::move( cb ), handle );
+
+        return ask_about_code( "Analyze this decompiled code:\n"
+                               "1. What does the function do?\n"
+                               "2. Key variables and their purpose\n"
+                               "3. Suspicious or interesting patterns\n"
+                               "4. Suggested names for variables/functions",
+                               code, std::move( cb ), handle );
+    }
+
+    response_t c_llm_manager::explain_function( std::string_view pseudocode, stream_callback_t cb, const request_handle_t &handle ) {
+        return ask_about_code( "Explain what this function does. Be concise.", pseudocode, std::move( cb ), handle );
     }
 
-    response_t c_llm_manager::find_vulnerabilities( std::string_view code ) {
+    response_t c_llm_manager::find_vulnerabilities( std::string_view code, stream_callback_t cb, const request_handle_t &handle ) {
         std::string prompt  = "Analyze for security vulnerabilities:\n"
                               "- Buffer overflows\n"
                               "- Integer overflows\n"
@@ -967,14 +1638,14 @@ namespace ida_re::api {
                               "```c\n";
         prompt             += code;
         prompt             += "\n```";
-        return send( prompt );
+        return send_or_stream( prompt, std::move( cb ), handle );
     }
 
-    response_t c_llm_manager::suggest_name( std::string_view pseudocode ) {
+    response_t c_llm_manager::suggest_name( std::string_view pseudocode, stream_callback_t cb, const request_handle_t &handle ) {
         std::string prompt  = "Suggest a descriptive function name based on this code. "
                               "Reply with just the name.\n\n```c\n";
         prompt             += pseudocode;
         prompt             += "\n```";
-        return send( prompt );
+        return send_or_stream( prompt, std::move( cb ), handle );
     }
 } // namespace ida_re::api
@@ -1,5 +1,14 @@
 #pragma once
 
+#include "connection_pool.hpp"
+#include "rate_limiter.hpp"
+#include "token_budget.hpp"
+
+namespace httplib {
+    class SSLClient;
+    class Result;
+} // namespace httplib
+
 namespace ida_re::api {
     enum class e_provider {
         claude,
@@ -23,9 +32,23 @@ namespace ida_re::api {
         }
     }
 
+    // inverse of to_string( e_provider ), as stored in the config
+    constexpr std::optional< e_provider > provider_from_string( std::string_view name ) noexcept {
+        if ( name == "claude" )
+            return e_provider::claude;
+        if ( name == "openai" )
+            return e_provider::openai;
+        if ( name == "gemini" )
+            return e_provider::gemini;
+        if ( name == "openrouter" )
+            return e_provider::openrouter;
+        return std::nullopt;
+    }
+
     struct message_t {
         std::string m_role { };
         std::string m_content { };
+        bool        m_cache { false }; // prompt-cache breakpoint after this message (honoured when prompt caching is on)
 
         [[nodiscard]] static constexpr message_t user( std::string_view c ) {
             return { "user", std::string( c ) };
@@ -38,14 +61,33 @@ namespace ida_re::api {
         [[nodiscard]] static constexpr message_t system( std::string_view c ) {
             return { "system", std::string( c ) };
         }
+
+        // a large user turn that stays identical across follow-ups, e.g. the function under analysis
+        [[nodiscard]] static constexpr message_t cached_user( std::string_view c ) {
+            return { "user", std::string( c ), true };
+        }
     };
 
     struct token_usage_t {
-        int m_input { 0 };
+        int m_input { 0 }; // prompt tokens processed without the prompt cache
         int m_output { 0 };
+        int m_cache_read { 0 };  // prompt tokens served from the provider's prompt cache
+        int m_cache_write { 0 }; // prompt tokens written to the prompt cache on this request
+
+        [[nodiscard]] constexpr int prompt( ) const noexcept {
+            return m_input + m_cache_read + m_cache_write;
+        }
 
         [[nodiscard]] constexpr int total( ) const noexcept {
-            return m_input + m_output;
+            return prompt( ) + m_output;
+        }
+
+        constexpr token_usage_t &operator+= ( const token_usage_t &other ) noexcept {
+            m_input       += other.m_input;
+            m_output      += other.m_output;
+            m_cache_read  += other.m_cache_read;
+            m_cache_write += other.m_cache_write;
+            return *this;
         }
     };
 
@@ -69,6 +111,42 @@ namespace ida_re::api {
 
     using stream_callback_t = std::function< void( std::string_view chunk ) >;
 
+    // One request in flight. Pass a handle from make_request( ) to send( ) / stream( ) to cancel that request
+    // alone or follow it from another thread; calls made without one get a private handle. A handle serves a
+    // single request. A child handle (a hedged lane) also counts as cancelled once its parent is.
+    struct request_state_t {
+        std::uint64_t                      m_id { 0 };
+        std::shared_ptr< request_state_t > m_parent { };
+        std::atomic< bool >                m_cancel { false };
+        std::atomic< bool >                m_done { false };
+        std::atomic< std::size_t >         m_received { 0 }; // reply characters so far
+        token_usage_t                      m_usage { };      // valid once done( )
+
+        void cancel( ) noexcept {
+            m_cancel.store( true, std::memory_order_release );
+        }
+
+        [[nodiscard]] bool cancelled( ) const noexcept {
+            return m_cancel.load( std::memory_order_acquire ) || ( m_parent && m_parent->cancelled( ) );
+        }
+
+        [[nodiscard]] bool done( ) const noexcept {
+            return m_done.load( std::memory_order_acquire );
+        }
+
+        // records the outcome; m_usage may be read once done( ) returns true
+        void finish( const response_t &resp ) noexcept {
+            m_usage = resp.m_usage;
+            m_received.store( resp.m_content.size( ), std::memory_order_relaxed );
+            m_done.store( true, std::memory_order_release );
+        }
+    };
+
+    using request_handle_t = std::shared_ptr< request_state_t >;
+
+    // a new handle with a process-unique id
+    [[nodiscard]] request_handle_t make_request( request_handle_t parent = { } );
+
     struct model_t {
         std::string m_id { };
         std::string m_name { };
@@ -84,6 +162,10 @@ namespace ida_re::api {
         std::string m_base_url { };
         int         m_max_tokens { 4096 };
         float       m_temperature { 0.7f };
+        bool        m_prompt_caching { false }; // Claude: mark the system prompt and cached_user( ) turns with cache_control
+        int         m_requests_per_minute { 0 };  // client-side throttle, 0 = unlimited
+        int         m_tokens_per_minute { 0 };    // prompt tokens (estimated) per minute, 0 = unlimited
+        int         m_max_retries { 3 };          // per request, for 429/5xx/529 and connection failures
     };
 
     // Base client template
@@ -110,6 +192,25 @@ namespace ida_re::api {
             m_config.m_max_tokens = tokens;
         }
 
+        void set_prompt_caching( bool enabled ) {
+            const std::lock_guard< std::mutex > lk( m_mutex );
+            m_config.m_prompt_caching = enabled;
+        }
+
+        void set_rate_limits( int requests_per_minute, int tokens_per_minute ) {
+            {
+                const std::lock_guard< std::mutex > lk( m_mutex );
+                m_config.m_requests_per_minute = requests_per_minute;
+                m_config.m_tokens_per_minute   = tokens_per_minute;
+            }
+            m_limiter.configure( requests_per_minute, tokens_per_minute );
+        }
+
+        void set_max_retries( int retries ) {
+            const std::lock_guard< std::mutex > lk( m_mutex );
+            m_config.m_max_retries = std::max( retries, 0 );
+        }
+
         [[nodiscard]] bool has_api_key( ) const {
             const std::lock_guard< std::mutex > lk( m_mutex );
             return !m_config.m_api_key.empty( );
@@ -120,50 +221,100 @@ namespace ida_re::api {
             return m_config.m_model;
         }
 
-        [[nodiscard]] bool is_busy( ) const noexcept {
-            return m_busy.load( );
+        [[nodiscard]] std::string get_system_prompt( ) const {
+            const std::lock_guard< std::mutex > lk( m_mutex );
+            return m_config.m_system_prompt;
+        }
+
+        [[nodiscard]] int get_max_tokens( ) const {
+            const std::lock_guard< std::mutex > lk( m_mutex );
+            return m_config.m_max_tokens;
         }
 
-        void cancel( ) noexcept {
-            m_cancel.store( true );
+        [[nodiscard]] bool is_busy( ) const {
+            const std::lock_guard< std::mutex > lk( m_mutex );
+            return !m_requests.empty( );
+        }
+
+        [[nodiscard]] std::size_t active_requests( ) const {
+            const std::lock_guard< std::mutex > lk( m_mutex );
+            return m_requests.size( );
+        }
+
+        // cancels every request in flight on this client; cancel a single one through its handle
+        void cancel( ) {
+            const std::lock_guard< std::mutex > lk( m_mutex );
+            for ( const auto &request : m_requests ) {
+                request->cancel( );
+            }
+        }
+
+        // latency and reuse counters of the provider's keep-alive TLS connections
+        [[nodiscard]] connection_stats_t connection_stats( ) const {
+            return m_pool.stats( );
         }
 
       protected:
-        client_config_t     m_config { };
-        mutable std::mutex  m_mutex { };
-        std::atomic< bool > m_busy { false };
-        std::atomic< bool > m_cancel { false };
+        using pool_t = c_connection_pool< httplib::SSLClient >;
+
+        client_config_t                 m_config { };
+        mutable std::mutex              m_mutex { };
+        std::vector< request_handle_t > m_requests { }; // in flight, guarded by m_mutex
+        pool_t                          m_pool;         // no brace-init: httplib::SSLClient is only complete in llm_api.cpp
+        std::string                     m_pool_host { };
+        c_rate_limiter                  m_limiter { };
+
+        // Points m_pool at host; connections to a previously used host are closed. Defined in llm_api.cpp
+        void use_host( const std::string &host );
 
         [[nodiscard]] client_config_t snapshot( ) const {
             const std::lock_guard< std::mutex > lk( m_mutex );
             return m_config;
         }
 
+        // Registers one request with the client for its lifetime, so is_busy( ) and cancel( ) see it
         struct guard_t {
-            std::atomic< bool > &busy;
-            std::atomic< bool > &cancel;
+            c_client_base   &client;
+            request_handle_t state;
 
-            guard_t( std::atomic< bool > &b, std::atomic< bool > &c ) : busy( b ), cancel( c ) {
-                busy.store( true, std::memory_order_release );
-                cancel.store( false, std::memory_order_release );
+            guard_t( c_client_base &c, const request_handle_t &handle ) : client( c ), state( handle ? handle : make_request( ) ) {
+                const std::lock_guard< std::mutex > lk( client.m_mutex );
+                client.m_requests.push_back( state );
             }
 
             ~guard_t( ) {
-                busy.store( false, std::memory_order_release );
+                const std::lock_guard< std::mutex > lk( client.m_mutex );
+                std::erase( client.m_requests, state );
             }
 
+            guard_t( const guard_t & )             = delete;
+            guard_t &operator= ( const guard_t & ) = delete;
+
             [[nodiscard]] bool cancelled( ) const noexcept {
-                return cancel.load( std::memory_order_acquire );
+                return state->cancelled( );
             }
         };
+
+        // records resp on the caller's handle, if there is one, and passes it through
+        static response_t finished( const request_handle_t &handle, response_t resp ) {
+            if ( handle )
+                handle->finish( resp );
+            return resp;
+        }
+
+        // One logical request of about `tokens` prompt tokens: waits for the rate limiter, runs request on a
+        // pooled connection and retries throttled (429), overloaded (529/503) and failed exchanges with
+        // jittered backoff, honouring Retry-After. A set *delivered (streamed text already handed out)
+        // stops further retries. Defined in llm_api.cpp
+        template < typename request_fn_t >
+        httplib::Result execute( std::size_t tokens, const guard_t &guard, request_fn_t &&request, const bool *delivered = nullptr );
     };
 
     // Claude
     class c_claude : public c_client_base< c_claude > {
       public:
-        c_claude( ) {
-            m_config.m_model = "claude-sonnet-4-5-20250929";
-        }
+        c_claude( );
+        ~c_claude( );
 
         void set_base_url( std::string_view url ) {
             const std::lock_guard< std::mutex > lk( m_mutex );
@@ -171,9 +322,9 @@ namespace ida_re::api {
         }
 
         response_t send( std::string_view message );
-        response_t send( const std::vector< message_t > &messages );
-        void       stream( std::string_view message, stream_callback_t cb );
-        void       stream( const std::vector< message_t > &messages, stream_callback_t cb );
+        response_t send( const std::vector< message_t > &messages, const request_handle_t &handle = { } );
+        response_t stream( std::string_view message, stream_callback_t cb );
+        response_t stream( const std::vector< message_t > &messages, stream_callback_t cb, const request_handle_t &handle = { } );
 
         [[nodiscard]] static consteval e_provider provider( ) noexcept {
             return e_provider::claude;
@@ -182,18 +333,17 @@ namespace ida_re::api {
         [[nodiscard]] static std::vector< model_t > models( );
 
       private:
-        response_t  request( const json_t &body );
-        void        stream_request( const json_t &body, stream_callback_t cb );
-        json_t      make_body( const std::vector< message_t > &msgs, bool stream ) const;
+        response_t  request( const json_t &body, const request_handle_t &handle );
+        response_t  stream_request( const json_t &body, stream_callback_t cb, const request_handle_t &handle );
+        json_t      make_body( const client_config_t &cfg, const std::vector< message_t > &msgs, bool stream ) const;
         std::string sanitize_host( std::string_view base_url ) const;
     };
 
     // OpenAI
     class c_openai : public c_client_base< c_openai > {
       public:
-        c_openai( ) {
-            m_config.m_model = "gpt-4o";
-        }
+        c_openai( );
+        ~c_openai( );
 
         void set_base_url( std::string_view url ) {
             const std::lock_guard< std::mutex > lk( m_mutex );
@@ -201,9 +351,9 @@ namespace ida_re::api {
         }
 
         response_t send( std::string_view message );
-        response_t send( const std::vector< message_t > &messages );
-        void       stream( std::string_view message, stream_callback_t cb );
-        void       stream( const std::vector< message_t > &messages, stream_callback_t cb );
+        response_t send( const std::vector< message_t > &messages, const request_handle_t &handle = { } );
+        response_t stream( std::string_view message, stream_callback_t cb );
+        response_t stream( const std::vector< message_t > &messages, stream_callback_t cb, const request_handle_t &handle = { } );
 
         [[nodiscard]] static consteval e_provider provider( ) noexcept {
             return e_provider::openai;
@@ -212,23 +362,22 @@ namespace ida_re::api {
         [[nodiscard]] static std::vector< model_t > models( );
 
       private:
-        response_t  request( const json_t &body );
-        void        stream_request( const json_t &body, stream_callback_t cb );
-        json_t      make_body( const std::vector< message_t > &msgs, bool stream ) const;
+        response_t  request( const json_t &body, const request_handle_t &handle );
+        response_t  stream_request( const json_t &body, stream_callback_t cb, const request_handle_t &handle );
+        json_t      make_body( const client_config_t &cfg, const std::vector< message_t > &msgs, bool stream ) const;
         std::string sanitize_host( std::string_view base_url ) const;
     };
 
     // Gemini (Google AI)
     class c_gemini : public c_client_base< c_gemini > {
       public:
-        c_gemini( ) {
-            m_config.m_model = "gemini-2.0-flash";
-        }
+        c_gemini( );
+        ~c_gemini( );
 
         response_t send( std::string_view message );
-        response_t send( const std::vector< message_t > &messages );
-        void       stream( std::string_view message, stream_callback_t cb );
-        void       stream( const std::vector< message_t > &messages, stream_callback_t cb );
+        response_t send( const std::vector< message_t > &messages, const request_handle_t &handle = { } );
+        response_t stream( std::string_view message, stream_callback_t cb );
+        response_t stream( const std::vector< message_t > &messages, stream_callback_t cb, const request_handle_t &handle = { } );
 
         [[nodiscard]] static consteval e_provider provider( ) noexcept {
             return e_provider::gemini;
@@ -237,23 +386,22 @@ namespace ida_re::api {
         [[nodiscard]] static std::vector< model_t > models( );
 
       private:
-        response_t  request( const std::vector< message_t > &messages );
-        void        stream_request( const std::vector< message_t > &messages, stream_callback_t cb );
-        json_t      make_body( const std::vector< message_t > &msgs ) const;
-        std::string get_url( bool stream ) const;
+        response_t  request( const std::vector< message_t > &messages, const request_handle_t &handle );
+        response_t  stream_request( const std::vector< message_t > &messages, stream_callback_t cb, const request_handle_t &handle );
+        json_t      make_body( const client_config_t &cfg, const std::vector< message_t > &msgs ) const;
+        std::string get_url( const client_config_t &cfg, bool stream ) const;
     };
 
     // OpenRouter (multi-model aggregator)
     class c_openrouter : public c_client_base< c_openrouter > {
       public:
-        c_openrouter( ) {
-            m_config.m_model = "mistralai/devstral-small:free";
-        }
+        c_openrouter( );
+        ~c_openrouter( );
 
         response_t send( std::string_view message );
-        response_t send( const std::vector< message_t > &messages );
-        void       stream( std::string_view message, stream_callback_t cb );
-        void       stream( const std::vector< message_t > &messages, stream_callback_t cb );
+        response_t send( const std::vector< message_t > &messages, const request_handle_t &handle = { } );
+        response_t stream( std::string_view message, stream_callback_t cb );
+        response_t stream( const std::vector< message_t > &messages, stream_callback_t cb, const request_handle_t &handle = { } );
 
         [[nodiscard]] static consteval e_provider provider( ) noexcept {
             return e_provider::openrouter;
@@ -261,28 +409,46 @@ namespace ida_re::api {
 
         // Dynamic model fetching
         [[nodiscard]] std::vector< model_t > fetch_models( bool force_refresh = false );
-        [[nodiscard]] const std::vector< model_t > &cached_models( ) const noexcept {
+        [[nodiscard]] std::vector< model_t > cached_models( ) const {
+            const std::lock_guard< std::mutex > lk( m_mutex );
             return m_cached_models;
         }
 
         void set_show_free_only( bool free_only ) noexcept {
-            m_show_free_only = free_only;
+            m_show_free_only.store( free_only, std::memory_order_relaxed );
         }
 
         [[nodiscard]] bool show_free_only( ) const noexcept {
-            return m_show_free_only;
+            return m_show_free_only.load( std::memory_order_relaxed );
+        }
+
+        // context_length reported by the models endpoint, 0 when the model has not been fetched
+        [[nodiscard]] int context_window( const std::string &model ) const {
+            const std::lock_guard< std::mutex > lk( m_mutex );
+            const auto                          it = m_context_windows.find( model );
+            return it != m_context_windows.end( ) ? it->second : 0;
         }
 
       private:
-        response_t                                        request( const json_t &body );
-        void                                              stream_request( const json_t &body, stream_callback_t cb );
-        json_t                                            make_body( const std::vector< message_t > &msgs, bool stream ) const;
-        std::vector< model_t >                            parse_models_response( const json_t &data );
-
-        std::vector< model_t >                            m_cached_models { };
-        std::chrono::steady_clock::time_point             m_models_fetched_at { };
-        bool                                              m_show_free_only { true };
-        static constexpr std::chrono::minutes             k_cache_duration { 30 };
+        response_t             request( const json_t &body, const request_handle_t &handle );
+        response_t             stream_request( const json_t &body, stream_callback_t cb, const request_handle_t &handle );
+        json_t                 make_body( const client_config_t &cfg, const std::vector< message_t > &msgs, bool stream ) const;
+        std::vector< model_t > parse_models_response( const json_t &data );
+
+        std::vector< model_t >                 m_cached_models { };     // guarded by m_mutex
+        std::unordered_map< std::string, int > m_context_windows { };   // guarded by m_mutex
+        std::chrono::steady_clock::time_point  m_models_fetched_at { }; // guarded by m_mutex
+        std::atomic< bool >                    m_show_free_only { true };
+        static constexpr std::chrono::minutes  k_cache_duration { 30 };
+    };
+
+    // Backup provider raced against the selected one. A request goes to the selected provider first; when it
+    // has streamed no text within m_first_token_deadline, or failed before streaming any, the same request
+    // is issued to m_secondary. Whichever streams text first wins and the other is cancelled.
+    struct hedge_policy_t {
+        bool                      m_enabled { false };
+        e_provider                m_secondary { e_provider::openrouter };
+        std::chrono::milliseconds m_first_token_deadline { 5000 };
     };
 
     // Manager
@@ -290,6 +456,12 @@ namespace ida_re::api {
       public:
         c_llm_manager( ) = default;
 
+        // cancels the hedged lanes still running and waits for them
+        ~c_llm_manager( );
+
+        c_llm_manager( const c_llm_manager & )            = delete;
+        c_llm_manager &operator=( const c_llm_manager & ) = delete;
+
         void set_provider( e_provider p ) noexcept {
             m_provider = p;
         }
@@ -314,24 +486,88 @@ namespace ida_re::api {
             return m_openrouter;
         }
 
+        // Hedging only applies while m_secondary differs from the selected provider; it needs that
+        // provider's API key and model set on its client.
+        void set_hedge_policy( const hedge_policy_t &policy ) {
+            const std::lock_guard< std::mutex > lk( m_hedge_mutex );
+            m_hedge = policy;
+        }
+
+        [[nodiscard]] hedge_policy_t get_hedge_policy( ) const {
+            const std::lock_guard< std::mutex > lk( m_hedge_mutex );
+            return m_hedge;
+        }
+
+        // handle, when given, cancels this request alone and reports its progress and usage
         response_t send( std::string_view message );
-        response_t send( const std::vector< message_t > &messages );
-        void       stream( std::string_view message, stream_callback_t cb );
+        response_t send( const std::vector< message_t > &messages, const request_handle_t &handle = { } );
+
+        // Like send( ), but text is handed to cb as it arrives: on the calling thread, or on the winning
+        // provider's thread when the request is hedged (never from two threads at once).
+        // The returned response still carries the full text, usage and finish reason.
+        response_t stream( std::string_view message, stream_callback_t cb );
+        response_t stream( const std::vector< message_t > &messages, stream_callback_t cb, const request_handle_t &handle = { } );
 
         std::vector< model_t > all_models( ) const;
 
-        // RE helpers
-        response_t analyze_code( std::string_view code, std::string_view prompt = "" );
-        response_t explain_function( std::string_view pseudocode );
-        response_t find_vulnerabilities( std::string_view code );
-        response_t suggest_name( std::string_view pseudocode );
+        // context window of the selected model; providers' defaults for models not in the lists
+        [[nodiscard]] int            context_window( ) const;
+        [[nodiscard]] c_token_budget token_budget( ) const;
+        [[nodiscard]] int            context_window( e_provider provider ) const;
+        [[nodiscard]] c_token_budget token_budget( e_provider provider ) const;
+
+        // RE helpers; passing cb streams the reply, passing handle lets another thread cancel the whole job.
+        // analyze_code and explain_function switch to map-reduce when the function does not fit the window:
+        // the pseudocode is split at statement boundaries, every piece is summarized with up to
+        // k_max_parallel_chunks requests in flight, and one final request (the only one streamed) merges them.
+        // When the summaries themselves overflow the window, consecutive ones are merged in groups first.
+        // Every request of the job runs on a child of handle; the final one runs on handle itself.
+        static constexpr std::size_t k_max_parallel_chunks = 4;
+
+        response_t analyze_code( std::string_view code, std::string_view prompt = "", stream_callback_t cb = { },
+                                 const request_handle_t &handle = { } );
+        response_t explain_function( std::string_view pseudocode, stream_callback_t cb = { }, const request_handle_t &handle = { } );
+        response_t find_vulnerabilities( std::string_view code, stream_callback_t cb = { }, const request_handle_t &handle = { } );
+        response_t suggest_name( std::string_view pseudocode, stream_callback_t cb = { }, const request_handle_t &handle = { } );
+
+        // Everything besides the code that shapes the RE helpers' replies: selected provider and model, its
+        // system prompt and k_prompt_revision. Part of the key under which their results are cached by content.
+        [[nodiscard]] std::string prompt_identity( ) const;
+
+        // bump whenever the wording of the RE helpers' prompts changes, so results cached under the old one stop matching
+        static constexpr int k_prompt_revision = 1;
 
       private:
-        e_provider   m_provider { e_provider::claude };
-        c_claude     m_claude { };
-        c_openai     m_openai { };
-        c_gemini     m_gemini { };
-        c_openrouter m_openrouter { };
+        response_t send_or_stream( std::string_view prompt, stream_callback_t cb, const request_handle_t &handle = { } );
+        response_t ask_about_code( std::string_view task, std::string_view code, stream_callback_t cb, const request_handle_t &handle );
+        response_t map_reduce( std::string_view task, std::string_view code, const c_token_budget &budget, stream_callback_t cb,
+                               const request_handle_t &handle );
+
+        // a trimmed copy when messages would overflow provider's window, nothing when they fit as they are
+        [[nodiscard]] std::optional< std::vector< message_t > > fit_to_window( e_provider                      provider,
+                                                                               const std::vector< message_t > &messages ) const;
+
+        // streams messages to one provider, fitted to that provider's window
+        response_t dispatch( e_provider provider, const std::vector< message_t > &messages, const stream_callback_t &cb,
+                             const request_handle_t &handle );
+
+        // the policy when a request should be hedged right now
+        [[nodiscard]] std::optional< hedge_policy_t > active_hedge( ) const;
+        response_t hedged( const std::vector< message_t > &messages, const hedge_policy_t &policy, stream_callback_t cb,
+                           const request_handle_t &handle );
+
+        e_provider         m_provider { e_provider::claude };
+        c_claude           m_claude { };
+        c_openai           m_openai { };
+        c_gemini           m_gemini { };
+        c_openrouter       m_openrouter { };
+        hedge_policy_t     m_hedge { };
+        mutable std::mutex m_hedge_mutex { };
+
+        // handles of the hedged lanes whose threads are still running; a cancelled loser can outlive its hedged( )
+        std::mutex                      m_lanes_mutex { };
+        std::condition_variable         m_lanes_cv { };
+        std::vector< request_handle_t > m_lanes { };
     };
 
 } // namespace ida_re::api
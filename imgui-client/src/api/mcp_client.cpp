@@ -4,23 +4,210 @@
 #include <httplib.h>
 
 namespace ida_re::api {
-    bool c_mcp_client::connect( ) {
-        std::lock_guard< std::mutex > lock( m_mutex );
+    namespace {
+        constexpr time_t k_connect_timeout = 10;
+        constexpr size_t k_async_workers   = 4;
+
+        // Runs one request on a pooled connection and records its latency. A keep-alive socket the
+        // plugin closed while it sat idle fails before the request is written; that case is retried
+        // once on a fresh connection. Read failures are not retried since the tool may already have run.
+        template < typename request_fn_t >
+        httplib::Result round_trip( c_connection_pool< httplib::Client > &pool, time_t read_timeout, request_fn_t &&request ) {
+            httplib::Result res;
+
+            for ( int attempt = 0; attempt < 2; ++attempt ) {
+                auto lease = pool.acquire( );
+                if ( !lease ) {
+                    break;
+                }
+
+                lease->set_read_timeout( read_timeout );
+
+                const auto start = std::chrono::steady_clock::now( );
+                res              = request( *lease );
+                pool.record( std::chrono::duration_cast< std::chrono::microseconds >( std::chrono::steady_clock::now( ) - start ),
+                             static_cast< bool >( res ) );
+
+                if ( res ) {
+                    break;
+                }
+
+                lease.discard( );
+                if ( !lease.reused( ) || res.error( ) == httplib::Error::Read ) {
+                    break;
+                }
+            }
+
+            return res;
+        }
+
+        // a tool reports failure through an "error" key inside its result object
+        mcp_tool_result_t to_tool_result( json_t data ) {
+            mcp_tool_result_t result;
+            result.m_data    = std::move( data );
+            result.m_success = !result.m_data.contains( "error" );
+            if ( !result.m_success ) {
+                result.m_error = result.m_data.value( "error", "Unknown error" );
+            }
+            return result;
+        }
+    } // namespace
+
+    c_mcp_client::c_mcp_client( ) {
+        reset_pool( );
+    }
+
+    c_mcp_client::~c_mcp_client( ) {
+        {
+            std::lock_guard< std::mutex > lock( m_task_mutex );
+            m_stopping = true;
+            m_tasks.clear( );
+        }
+        m_task_cv.notify_all( );
+
+        for ( auto &worker : m_workers ) {
+            if ( worker.joinable( ) )
+                worker.join( );
+        }
+    }
+
+    void c_mcp_client::enqueue( std::function< void( ) > task ) {
+        {
+            std::lock_guard< std::mutex > lock( m_task_mutex );
+            if ( m_stopping )
+                return;
+
+            // workers are started on first use so a client that never goes async costs no threads
+            if ( m_workers.empty( ) ) {
+                for ( size_t i = 0; i < k_async_workers; ++i ) {
+                    m_workers.emplace_back( &c_mcp_client::worker_loop, this );
+                }
+            }
+
+            m_tasks.push_back( std::move( task ) );
+        }
+        m_task_cv.notify_one( );
+    }
+
+    void c_mcp_client::worker_loop( ) {
+        for ( ;; ) {
+            std::function< void( ) > task;
+            {
+                std::unique_lock< std::mutex > lock( m_task_mutex );
+                m_task_cv.wait( lock, [ this ] { return m_stopping || !m_tasks.empty( ); } );
+                if ( m_stopping )
+                    return;
+
+                task = std::move( m_tasks.front( ) );
+                m_tasks.pop_front( );
+            }
+
+            try {
+                task( );
+            } catch ( ... ) { }
+        }
+    }
+
+    void c_mcp_client::post_completion( std::function< void( ) > completion ) {
+        std::lock_guard< std::mutex > lock( m_completion_mutex );
+        m_completions.push_back( std::move( completion ) );
+    }
+
+    void c_mcp_client::poll_completions( ) {
+        std::vector< std::function< void( ) > > completions;
+        {
+            std::lock_guard< std::mutex > lock( m_completion_mutex );
+            if ( m_completions.empty( ) )
+                return;
+            completions.swap( m_completions );
+        }
+
+        // run outside the lock so a callback can queue more work
+        for ( auto &completion : completions ) {
+            completion( );
+        }
+    }
+
+    std::future< mcp_tool_result_t > c_mcp_client::call_tool_async( std::string name, json_t arguments ) {
+        return submit( [ name = std::move( name ), arguments = std::move( arguments ) ]( c_mcp_client &client ) {
+            return client.call_tool( name, arguments );
+        } );
+    }
+
+    void c_mcp_client::call_tool_async( std::string name, json_t arguments, mcp_tool_callback_t on_done ) {
+        submit( [ name = std::move( name ), arguments = std::move( arguments ) ]( c_mcp_client &client ) { return client.call_tool( name, arguments ); },
+                std::move( on_done ) );
+    }
+
+    void c_mcp_client::call_tools_batch_async( std::vector< mcp_tool_call_t > calls, mcp_batch_callback_t on_done ) {
+        submit( [ calls = std::move( calls ) ]( c_mcp_client &client ) { return client.call_tools_batch( calls ); }, std::move( on_done ) );
+    }
 
-        httplib::Client client( m_host, m_port );
-        client.set_connection_timeout( 5 );
-        client.set_read_timeout( 5 );
+    void c_mcp_client::set_host( std::string_view host ) {
+        {
+            std::lock_guard< std::mutex > lock( m_state_mutex );
+            m_host = host;
+        }
+        reset_pool( );
+    }
+
+    void c_mcp_client::set_port( int port ) {
+        {
+            std::lock_guard< std::mutex > lock( m_state_mutex );
+            m_port = port;
+        }
+        reset_pool( );
+    }
 
-        auto res = client.Get( "/health" );
+    void c_mcp_client::set_pool_size( std::size_t size ) {
+        m_pool.set_max_size( size );
+    }
+
+    std::string c_mcp_client::get_last_error( ) const {
+        std::lock_guard< std::mutex > lock( m_state_mutex );
+        return m_last_error;
+    }
+
+    void c_mcp_client::set_last_error( std::string error ) {
+        std::lock_guard< std::mutex > lock( m_state_mutex );
+        m_last_error = std::move( error );
+    }
+
+    void c_mcp_client::reset_pool( ) {
+        std::string host;
+        int         port;
+        {
+            std::lock_guard< std::mutex > lock( m_state_mutex );
+            host = m_host;
+            port = m_port;
+        }
+
+        // the factory captures host/port by value, so swapping it also retires connections to the old endpoint
+        m_pool.set_factory( [ host = std::move( host ), port ] {
+            auto client = std::make_unique< httplib::Client >( host, port );
+            client->set_keep_alive( true );
+            client->set_tcp_nodelay( true );
+            client->set_connection_timeout( k_connect_timeout );
+            return client;
+        } );
+    }
+
+    bool c_mcp_client::connect( ) {
+        auto res = round_trip( m_pool, 5, []( httplib::Client &client ) { return client.Get( "/health" ); } );
         if ( !res ) {
-            m_last_error = "Cannot connect to IDA MCP server at " + m_host + ":" + std::to_string( m_port );
-            m_connected  = false;
+            std::string endpoint;
+            {
+                std::lock_guard< std::mutex > lock( m_state_mutex );
+                endpoint = m_host + ":" + std::to_string( m_port );
+            }
+            set_last_error( "Cannot connect to IDA MCP server at " + endpoint );
+            m_connected = false;
             return false;
         }
 
         if ( res->status != 200 ) {
-            m_last_error = "Server returned status " + std::to_string( res->status );
-            m_connected  = false;
+            set_last_error( "Server returned status " + std::to_string( res->status ) );
+            m_connected = false;
             return false;
         }
 
@@ -32,70 +219,76 @@ namespace ida_re::api {
             }
         } catch ( ... ) { }
 
-        m_last_error = "Invalid response from server";
-        m_connected  = false;
+        set_last_error( "Invalid response from server" );
+        m_connected = false;
         return false;
     }
 
-    json_t c_mcp_client::http_get( const std::string &path ) {
-        std::lock_guard< std::mutex > lock( m_mutex );
+    void c_mcp_client::disconnect( ) {
+        m_connected.store( false, std::memory_order_release );
+        ++m_listing_generation;
+        m_pool.clear( );
+    }
 
-        httplib::Client client( m_host, m_port );
-        client.set_connection_timeout( 10 );
-        client.set_read_timeout( 30 );
+    // Neither helper touches shared state besides the pool and the connected flag, so any number of
+    // threads can have requests in flight at once (bounded by the pool size).
+    c_mcp_client::http_result_t c_mcp_client::http_get( const std::string &path ) {
+        http_result_t result;
 
-        auto res = client.Get( path );
+        auto res = round_trip( m_pool, 30, [ & ]( httplib::Client &client ) { return client.Get( path ); } );
         if ( !res ) {
-            m_last_error = "HTTP GET failed";
-            m_connected  = false;
-            return nullptr;
+            result.m_error = "HTTP GET failed: " + httplib::to_string( res.error( ) );
+            m_connected    = false;
+            return result;
         }
 
+        result.m_status = res->status;
         if ( res->status != 200 ) {
-            m_last_error = "HTTP " + std::to_string( res->status );
-            return nullptr;
+            result.m_error = "HTTP " + std::to_string( res->status );
+            return result;
         }
 
         try {
-            return json_t::parse( res->body );
+            result.m_body = json_t::parse( res->body );
         } catch ( ... ) {
-            m_last_error = "JSON parse error";
-            return nullptr;
+            result.m_error = "JSON parse error";
         }
-    }
 
-    json_t c_mcp_client::http_post( const std::string &path, const json_t &data ) {
-        std::lock_guard< std::mutex > lock( m_mutex );
+        return result;
+    }
 
-        httplib::Client client( m_host, m_port );
-        client.set_connection_timeout( 10 );
-        client.set_read_timeout( 60 );
+    c_mcp_client::http_result_t c_mcp_client::http_post( const std::string &path, const json_t &data ) {
+        http_result_t result;
 
-        auto res = client.Post( path, data.dump( ), "application/json_t" );
+        const auto body = data.dump( );
+        auto       res  = round_trip( m_pool, 60, [ & ]( httplib::Client &client ) { return client.Post( path, body, "application/json" ); } );
         if ( !res ) {
-            m_last_error = "HTTP POST failed";
-            m_connected  = false;
-            return nullptr;
+            result.m_error = "HTTP POST failed: " + httplib::to_string( res.error( ) );
+            m_connected    = false;
+            return result;
         }
 
+        result.m_status = res->status;
         if ( res->status != 200 ) {
-            m_last_error = "HTTP " + std::to_string( res->status );
-            return nullptr;
+            result.m_error = "HTTP " + std::to_string( res->status );
+            return result;
         }
 
         try {
-            return json_t::parse( res->body );
+            result.m_body = json_t::parse( res->body );
         } catch ( ... ) {
-            m_last_error = "JSON parse error";
-            return nullptr;
+            result.m_error = "JSON parse error";
         }
+
+        return result;
     }
 
     std::vector< mcp_tool_t > c_mcp_client::list_tools( ) {
         std::vector< mcp_tool_t > tools;
 
-        auto resp = http_get( "/tools" );
-        if ( resp.is_null( ) || !resp.contains( "tools" ) ) {
+        auto  http = http_get( "/tools" );
+        auto &resp = http.m_body;
+        if ( !http.ok( ) || !resp.contains( "tools" ) ) {
             return tools;
         }
 
@@ -120,11 +313,12 @@ namespace ida_re::api {
             { "arguments", arguments }
         };
 
-        auto resp = http_post( "/call", req );
+        auto  http = http_post( "/call", req );
+        auto &resp = http.m_body;
 
-        if ( resp.is_null( ) ) {
+        if ( !http.ok( ) ) {
             result.m_success = false;
-            result.m_error   = m_last_error;
+            result.m_error   = std::move( http.m_error );
             return result;
         }
 
@@ -135,11 +329,7 @@ namespace ida_re::api {
         }
 
         if ( resp.contains( "result" ) ) {
-            result.m_data    = resp[ "result" ];
-            result.m_success = !result.m_data.contains( "error" );
-            if ( !result.m_success ) {
-                result.m_error = result.m_data.value( "error", "Unknown error" );
-            }
+            result = to_tool_result( std::move( resp[ "result" ] ) );
         } else {
             result.m_success = false;
             result.m_error   = "No result in response";
@@ -148,6 +338,57 @@ namespace ida_re::api {
         return result;
     }
 
+    std::vector< mcp_tool_result_t > c_mcp_client::call_tools_batch( std::span< const mcp_tool_call_t > calls ) {
+        std::vector< mcp_tool_result_t > results;
+        if ( calls.empty( ) ) {
+            return results;
+        }
+
+        json_t req_calls = json_t::array( );
+        for ( const auto &call : calls ) {
+            req_calls.push_back( {
+                {      "name",      call.m_name },
+                { "arguments", call.m_arguments }
+            } );
+        }
+
+        auto  http = http_post( "/batch", { { "calls", std::move( req_calls ) } } );
+        auto &resp = http.m_body;
+
+        // older plugin without the batch route
+        if ( http.m_status == 404 ) {
+            results.reserve( calls.size( ) );
+            for ( const auto &call : calls ) {
+                results.push_back( call_tool( call.m_name, call.m_arguments ) );
+            }
+            return results;
+        }
+
+        std::string error;
+        if ( !http.ok( ) ) {
+            error = std::move( http.m_error );
+        } else if ( resp.contains( "error" ) ) {
+            error = resp[ "error" ].get< std::string >( );
+        } else if ( !resp.contains( "results" ) || !resp[ "results" ].is_array( ) ) {
+            error = "No results in response";
+        }
+
+        results.reserve( calls.size( ) );
+        if ( error.empty( ) ) {
+            for ( auto &r : resp[ "results" ] ) {
+                results.push_back( to_tool_result( std::move( r ) ) );
+            }
+        }
+
+        // keep results index-aligned with calls even if the batch failed or came back short
+        while ( results.size( ) < calls.size( ) ) {
+            results.push_back( { false, { }, error.empty( ) ? "Missing result in batch response" : error } );
+        }
+        results.resize( calls.size( ) );
+
+        return results;
+    }
+
     mcp_tool_result_t c_mcp_client::get_function_pseudocode( std::string_view address ) {
         return call_tool( "get_function_pseudocode", {
                                                          { "address", address }
@@ -172,9 +413,53 @@ namespace ida_re::api {
         } );
     }
 
-    mcp_tool_result_t c_mcp_client::list_functions( int limit ) {
+    mcp_tool_result_t c_mcp_client::list_functions( int limit, int offset ) {
         return call_tool( "list_functions", {
-                                                { "limit", limit }
+                                                {  "limit",  limit },
+                                                { "offset", offset }
+        } );
+    }
+
+    void c_mcp_client::list_functions_paged( int page_size, mcp_function_page_callback_t on_page ) {
+        const auto generation = ++m_listing_generation;
+
+        enqueue( [ this, page_size, generation, on_page = std::move( on_page ) ]( ) {
+            std::size_t offset = 0;
+
+            while ( m_listing_generation.load( std::memory_order_acquire ) == generation ) {
+                auto result = list_functions( page_size, static_cast< int >( offset ) );
+
+                mcp_function_page_t page;
+                page.m_offset = offset;
+
+                if ( !result.m_success ) {
+                    page.m_error = result.m_error;
+                    page.m_done  = true;
+                } else {
+                    const auto &data = result.m_data;
+                    page.m_total     = data.value( "total", std::size_t { 0 } );
+
+                    if ( data.contains( "functions" ) ) {
+                        page.m_functions.reserve( data[ "functions" ].size( ) );
+                        for ( const auto &f : data[ "functions" ] ) {
+                            page.m_functions.push_back( { f.value( "address", "" ), f.value( "name", "" ), f.value( "size", std::uint64_t { 0 } ) } );
+                        }
+                    }
+
+                    // plugins without pagination return a single page and no next_offset
+                    const auto next = data.contains( "next_offset" ) && data[ "next_offset" ].is_number_unsigned( )
+                                          ? data[ "next_offset" ].get< std::size_t >( )
+                                          : offset;
+                    page.m_done     = next <= offset;
+                    offset          = next;
+                }
+
+                const bool done = page.m_done;
+                post_completion( [ on_page, page = std::move( page ) ]( ) mutable { on_page( std::move( page ) ); } );
+
+                if ( done )
+                    break;
+            }
         } );
     }
 
@@ -1,5 +1,11 @@
 #pragma once
 
+#include "connection_pool.hpp"
+
+namespace httplib {
+    class Client;
+} // namespace httplib
+
 namespace ida_re::api {
     struct mcp_tool_result_t {
         bool        m_success { false };
@@ -7,31 +13,57 @@ namespace ida_re::api {
         std::string m_error { };
     };
 
+    struct mcp_tool_call_t {
+        std::string m_name { };
+        json_t      m_arguments { };
+    };
+
+    struct mcp_function_t {
+        std::string   m_address { };
+        std::string   m_name { };
+        std::uint64_t m_size { 0 };
+    };
+
+    // one page of the plugin's function table
+    struct mcp_function_page_t {
+        std::vector< mcp_function_t > m_functions { };
+        std::size_t                   m_offset { 0 };
+        std::size_t                   m_total { 0 };
+        bool                          m_done { false };
+        std::string                   m_error { };
+    };
+
+    using mcp_tool_callback_t          = std::function< void( mcp_tool_result_t ) >;
+    using mcp_batch_callback_t         = std::function< void( std::vector< mcp_tool_result_t > ) >;
+    using mcp_function_page_callback_t = std::function< void( mcp_function_page_t ) >;
+
     struct mcp_tool_t {
         std::string m_name { };
         std::string m_description { };
         json_t      m_input_schema { };
     };
 
-    // HTTP-based MCP client that connects to IDA plugin's HTTP server
+    // HTTP-based MCP client that connects to IDA plugin's HTTP server.
+    // Requests go over a small pool of keep-alive connections instead of a fresh TCP connect per call.
     class c_mcp_client {
       public:
-        c_mcp_client( )  = default;
-        ~c_mcp_client( ) = default;
+        c_mcp_client( );
+        ~c_mcp_client( );
 
-        void set_host( std::string_view host ) {
-            m_host = host;
-        }
+        void set_host( std::string_view host );
+        void set_port( int port );
+
+        // maximum number of open keep-alive connections to the plugin
+        void set_pool_size( std::size_t size );
 
-        void set_port( int port ) noexcept {
-            m_port = port;
+        // idle connections older than this are closed instead of reused
+        void set_idle_timeout( std::chrono::seconds timeout ) {
+            m_pool.set_idle_timeout( timeout );
         }
 
         [[nodiscard]] bool connect( );
 
-        void disconnect( ) noexcept {
-            m_connected.store( false, std::memory_order_release );
-        }
+        void disconnect( );
 
         [[nodiscard]] bool is_connected( ) const noexcept {
             return m_connected.load( std::memory_order_acquire );
@@ -40,12 +72,16 @@ namespace ida_re::api {
         std::vector< mcp_tool_t > list_tools( );
         mcp_tool_result_t         call_tool( const std::string &name, const json_t &arguments );
 
+        // Runs all calls in one HTTP request and one hop to IDA's main thread; results keep call order.
+        // Falls back to sequential call_tool() against plugins that predate the /batch route.
+        std::vector< mcp_tool_result_t > call_tools_batch( std::span< const mcp_tool_call_t > calls );
+
         // convenience methods
         mcp_tool_result_t get_function_pseudocode( std::string_view address );
         mcp_tool_result_t get_function_assembly( std::string_view address );
         mcp_tool_result_t get_function_xrefs( std::string_view address );
         mcp_tool_result_t analyze_function( std::string_view address );
-        mcp_tool_result_t list_functions( int limit = 100 );
+        mcp_tool_result_t list_functions( int limit = 100, int offset = 0 );
         mcp_tool_result_t get_current_function( );
         mcp_tool_result_t rename_function( std::string_view address, std::string_view new_name );
         mcp_tool_result_t add_comment( std::string_view address, std::string_view comment, bool repeatable = false );
@@ -56,19 +92,95 @@ namespace ida_re::api {
                                                 std::optional< int > line_number = std::nullopt );
         mcp_tool_result_t get_function_local_variables( std::string_view address );
 
-        [[nodiscard]] std::string_view get_last_error( ) const noexcept {
-            return m_last_error;
+        // Async surface: fn( c_mcp_client & ) runs on a background worker so the caller never waits on
+        // the network. The result comes back as a future, or with on_done as a callback that is queued
+        // for the thread calling poll_completions( ) (the UI thread).
+        template < typename fn_t >
+        [[nodiscard]] auto submit( fn_t &&fn ) -> std::future< std::invoke_result_t< fn_t &, c_mcp_client & > > {
+            using result_t = std::invoke_result_t< fn_t &, c_mcp_client & >;
+
+            auto task   = std::make_shared< std::packaged_task< result_t( ) > >( [ this, fn = std::forward< fn_t >( fn ) ]( ) mutable {
+                return fn( *this );
+            } );
+            auto future = task->get_future( );
+            enqueue( [ task ]( ) { ( *task )( ); } );
+            return future;
+        }
+
+        template < typename fn_t, typename done_t >
+        void submit( fn_t &&fn, done_t &&on_done ) {
+            enqueue( [ this, fn = std::forward< fn_t >( fn ), on_done = std::forward< done_t >( on_done ) ]( ) mutable {
+                if constexpr ( std::is_void_v< std::invoke_result_t< fn_t &, c_mcp_client & > > ) {
+                    fn( *this );
+                    post_completion( std::move( on_done ) );
+                } else {
+                    post_completion( [ on_done = std::move( on_done ), result = fn( *this ) ]( ) mutable { on_done( std::move( result ) ); } );
+                }
+            } );
+        }
+
+        [[nodiscard]] std::future< mcp_tool_result_t > call_tool_async( std::string name, json_t arguments );
+        void call_tool_async( std::string name, json_t arguments, mcp_tool_callback_t on_done );
+        void call_tools_batch_async( std::vector< mcp_tool_call_t > calls, mcp_batch_callback_t on_done );
+
+        // Walks the whole function table page by page on a worker thread. on_page is queued for
+        // poll_completions( ) once per page; the last page has m_done set. Starting a new listing or
+        // disconnecting stops the previous one.
+        void list_functions_paged( int page_size, mcp_function_page_callback_t on_page );
+
+        // Runs callbacks queued by the async API. Call once per frame from the UI thread.
+        void poll_completions( );
+
+        // last connect() failure; per-call errors are reported in mcp_tool_result_t::m_error
+        [[nodiscard]] std::string get_last_error( ) const;
+
+        // per-call latency and connection reuse counters
+        [[nodiscard]] connection_stats_t get_stats( ) const {
+            return m_pool.stats( );
+        }
+
+        void reset_stats( ) {
+            m_pool.reset_stats( );
         }
 
       private:
-        json_t http_get( const std::string &path );
-        json_t http_post( const std::string &path, const json_t &data );
+        using pool_t = c_connection_pool< httplib::Client >;
+
+        struct http_result_t {
+            json_t      m_body { };
+            std::string m_error { };
+            int         m_status { 0 };
 
+            [[nodiscard]] bool ok( ) const noexcept {
+                return m_error.empty( );
+            }
+        };
+
+        void          reset_pool( );
+        void          set_last_error( std::string error );
+        void          enqueue( std::function< void( ) > task );
+        void          post_completion( std::function< void( ) > completion );
+        void          worker_loop( );
+        http_result_t http_get( const std::string &path );
+        http_result_t http_post( const std::string &path, const json_t &data );
+
+        // guards host/port/last error only; never held across a network round trip
+        mutable std::mutex  m_state_mutex { };
         std::string         m_host { "127.0.0.1" };
         int                 m_port { 13120 };
         std::atomic< bool > m_connected { false };
-        std::mutex          m_mutex { };
         std::string         m_last_error { };
+        pool_t              m_pool; // no brace-init: httplib::Client is only complete in the .cpp
+
+        // async workers
+        std::mutex                              m_task_mutex { };
+        std::condition_variable                 m_task_cv { };
+        std::deque< std::function< void( ) > >  m_tasks { };
+        std::vector< std::thread >              m_workers { };
+        bool                                    m_stopping { false };
+        std::atomic< std::uint64_t >            m_listing_generation { 0 };
+        std::mutex                              m_completion_mutex { };
+        std::vector< std::function< void( ) > > m_completions { };
     };
 
 } // namespace ida_re::api
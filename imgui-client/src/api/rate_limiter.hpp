@@ -0,0 +1,133 @@
+#pragma once
+
+namespace ida_re::api {
+    // Client-side throttle for one provider: a requests-per-minute and a tokens-per-minute bucket,
+    // a provider-wide pause set from 429/Retry-After responses, and a retry budget that caps
+    // retries at a fraction of traffic so an outage does not turn into a retry storm.
+    // All requests to a provider share one instance, so parallel callers pace each other.
+    class c_rate_limiter {
+      public:
+        using clock_t = std::chrono::steady_clock;
+
+        // 0 disables the corresponding bucket
+        void configure( int requests_per_minute, int tokens_per_minute ) {
+            std::lock_guard< std::mutex > lock( m_mutex );
+            const auto                    now = clock_t::now( );
+            m_requests.configure( requests_per_minute, now );
+            m_tokens.configure( tokens_per_minute, now );
+        }
+
+        // Blocks until a request estimated at `tokens` prompt tokens fits both buckets and any pause
+        // requested by the server has passed. Returns false if cancelled( ) turns true while waiting.
+        template < typename cancelled_fn_t >
+        [[nodiscard]] bool acquire( std::size_t tokens, cancelled_fn_t &&cancelled ) {
+            for ( ;; ) {
+                clock_t::duration wait { };
+                {
+                    std::lock_guard< std::mutex > lock( m_mutex );
+                    const auto                    now = clock_t::now( );
+
+                    m_requests.refill( now );
+                    m_tokens.refill( now );
+
+                    // a request larger than a whole minute's quota is let through once the bucket is full
+                    const double token_cost = std::min( static_cast< double >( tokens ), m_tokens.m_capacity );
+
+                    if ( now >= m_paused_until && m_requests.available( 1.0 ) && m_tokens.available( token_cost ) ) {
+                        m_requests.take( 1.0 );
+                        m_tokens.take( token_cost );
+                        m_retry_budget = std::min( m_retry_budget + k_retry_deposit, k_retry_budget_max );
+                        return true;
+                    }
+
+                    wait = std::max( { m_paused_until - now, m_requests.time_until( 1.0 ), m_tokens.time_until( token_cost ) } );
+                }
+
+                // sleep in slices so a cancelled request stops waiting promptly
+                const auto deadline = clock_t::now( ) + wait;
+                while ( clock_t::now( ) < deadline ) {
+                    if ( cancelled( ) )
+                        return false;
+                    std::this_thread::sleep_for( std::min< clock_t::duration >( deadline - clock_t::now( ), k_wait_slice ) );
+                }
+                if ( cancelled( ) )
+                    return false;
+            }
+        }
+
+        // Holds every request to this provider back for delay (Retry-After, or the backoff after a 429)
+        void pause_for( clock_t::duration delay ) {
+            std::lock_guard< std::mutex > lock( m_mutex );
+            m_paused_until = std::max( m_paused_until, clock_t::now( ) + delay );
+        }
+
+        // Spends one retry from the budget; false when retries are already a large share of traffic
+        [[nodiscard]] bool take_retry( ) {
+            std::lock_guard< std::mutex > lock( m_mutex );
+            if ( m_retry_budget < 1.0 )
+                return false;
+
+            m_retry_budget -= 1.0;
+            return true;
+        }
+
+        // Exponential backoff with equal jitter: half of base * 2^attempt, plus a random share of the other half
+        [[nodiscard]] clock_t::duration backoff( int attempt ) {
+            const auto ceiling = std::min< std::chrono::milliseconds >( k_backoff_base * ( 1LL << std::min( attempt, 10 ) ), k_backoff_max );
+
+            std::lock_guard< std::mutex > lock( m_mutex );
+            std::uniform_int_distribution< long long > jitter( 0, ceiling.count( ) / 2 );
+            return std::chrono::milliseconds( ceiling.count( ) / 2 + jitter( m_rng ) );
+        }
+
+      private:
+        static constexpr auto   k_wait_slice       = std::chrono::milliseconds( 100 );
+        static constexpr auto   k_backoff_base     = std::chrono::milliseconds( 1000 );
+        static constexpr auto   k_backoff_max      = std::chrono::milliseconds( 32000 );
+        static constexpr double k_retry_budget_max = 10.0; // burst of retries allowed after a quiet period
+        static constexpr double k_retry_deposit    = 0.2;  // each admitted request earns a fifth of a retry
+
+        struct bucket_t {
+            double              m_capacity { 0.0 }; // one minute's worth; 0 = unlimited
+            double              m_level { 0.0 };
+            double              m_per_second { 0.0 };
+            clock_t::time_point m_refilled { };
+
+            void configure( int per_minute, clock_t::time_point now ) noexcept {
+                m_capacity   = static_cast< double >( std::max( per_minute, 0 ) );
+                m_per_second = m_capacity / 60.0;
+                m_level      = m_capacity;
+                m_refilled   = now;
+            }
+
+            void refill( clock_t::time_point now ) noexcept {
+                const std::chrono::duration< double > elapsed = now - m_refilled;
+                m_level                                       = std::min( m_capacity, m_level + elapsed.count( ) * m_per_second );
+                m_refilled                                    = now;
+            }
+
+            [[nodiscard]] bool available( double amount ) const noexcept {
+                return m_capacity <= 0.0 || m_level >= amount;
+            }
+
+            void take( double amount ) noexcept {
+                if ( m_capacity > 0.0 )
+                    m_level -= amount;
+            }
+
+            [[nodiscard]] clock_t::duration time_until( double amount ) const noexcept {
+                if ( available( amount ) )
+                    return clock_t::duration::zero( );
+
+                return std::chrono::duration_cast< clock_t::duration >( std::chrono::duration< double >( ( amount - m_level ) / m_per_second ) );
+            }
+        };
+
+        mutable std::mutex  m_mutex { };
+        bucket_t            m_requests { };
+        bucket_t            m_tokens { };
+        clock_t::time_point m_paused_until { };
+        double              m_retry_budget { k_retry_budget_max };
+        std::mt19937_64     m_rng { std::random_device { }( ) };
+    };
+} // namespace ida_re::api
@@ -0,0 +1,87 @@
+#include "vendor.hpp"
+
+#include "sse_parser.hpp"
+
+namespace ida_re::api {
+    void c_sse_parser::feed( std::string_view chunk, const event_callback_t &on_event ) {
+        // drop what earlier calls consumed; one move per chunk instead of one erase per line
+        if ( m_event_start > 0 ) {
+            m_buffer.erase( 0, m_event_start );
+            m_line_start  -= m_event_start;
+            m_scan        -= m_event_start;
+            m_event_start  = 0;
+        }
+
+        m_buffer.append( chunk );
+
+        const std::string_view buffer( m_buffer );
+        for ( std::size_t newline; ( newline = buffer.find( '\n', m_scan ) ) != std::string_view::npos; ) {
+            std::string_view line = buffer.substr( m_line_start, newline - m_line_start );
+            if ( !line.empty( ) && line.back( ) == '\r' )
+                line.remove_suffix( 1 );
+
+            if ( line.empty( ) ) {
+                // blank line: everything since m_event_start is one event
+                dispatch( buffer.substr( m_event_start, m_line_start - m_event_start ), on_event );
+                m_event_start = newline + 1;
+            }
+
+            m_line_start = newline + 1;
+            m_scan       = newline + 1;
+        }
+
+        // the unterminated tail has been searched; the next chunk continues after it
+        m_scan = buffer.size( );
+    }
+
+    void c_sse_parser::finish( const event_callback_t &on_event ) {
+        if ( m_event_start < m_buffer.size( ) ) {
+            dispatch( std::string_view( m_buffer ).substr( m_event_start ), on_event );
+        }
+        reset( );
+    }
+
+    void c_sse_parser::dispatch( std::string_view block, const event_callback_t &on_event ) {
+        sse_event_t event;
+        std::size_t data_lines = 0;
+
+        while ( !block.empty( ) ) {
+            const auto newline = block.find( '\n' );
+            auto       line    = block.substr( 0, newline );
+            block              = newline == std::string_view::npos ? std::string_view { } : block.substr( newline + 1 );
+
+            if ( !line.empty( ) && line.back( ) == '\r' )
+                line.remove_suffix( 1 );
+
+            // empty lines never reach here; ':' starts a comment (keep-alive pings)
+            if ( line.empty( ) || line.front( ) == ':' )
+                continue;
+
+            const auto       colon = line.find( ':' );
+            std::string_view field = line.substr( 0, colon );
+            std::string_view value = colon == std::string_view::npos ? std::string_view { } : line.substr( colon + 1 );
+            if ( !value.empty( ) && value.front( ) == ' ' )
+                value.remove_prefix( 1 );
+
+            if ( field == "event" ) {
+                event.m_event = value;
+            } else if ( field == "data" ) {
+                // a single data line is handed out as-is; only multi-line payloads are joined
+                if ( data_lines == 0 ) {
+                    event.m_data = value;
+                } else {
+                    if ( data_lines == 1 )
+                        m_data.assign( event.m_data );
+                    m_data.push_back( '\n' );
+                    m_data.append( value );
+                    event.m_data = m_data;
+                }
+                data_lines++;
+            }
+        }
+
+        // per the spec an event without data is not dispatched
+        if ( data_lines > 0 )
+            on_event( event );
+    }
+} // namespace ida_re::api
@@ -0,0 +1,40 @@
+#pragma once
+
+namespace ida_re::api {
+    // One server-sent event. Views point into the parser's buffer and are only valid inside the callback.
+    struct sse_event_t {
+        std::string_view m_event { "message" }; // "event:" field, "message" when absent
+        std::string_view m_data { };            // "data:" lines joined with '\n'
+    };
+
+    // Incremental text/event-stream parser shared by every streaming LLM provider.
+    // Chunks are appended behind a read cursor; only complete events (terminated by a blank line)
+    // are parsed, and the consumed prefix is compacted away once per feed( ), so a long stream
+    // is scanned once regardless of how the transport splits it.
+    class c_sse_parser {
+      public:
+        using event_callback_t = std::function< void( const sse_event_t & ) >;
+
+        // Parses every event completed by chunk
+        void feed( std::string_view chunk, const event_callback_t &on_event );
+
+        // Dispatches a trailing event the server ended without a blank line
+        void finish( const event_callback_t &on_event );
+
+        void reset( ) noexcept {
+            m_buffer.clear( );
+            m_event_start = 0;
+            m_line_start  = 0;
+            m_scan        = 0;
+        }
+
+      private:
+        void dispatch( std::string_view block, const event_callback_t &on_event );
+
+        std::string m_buffer { };
+        std::string m_data { };          // scratch for multi-line data fields; keeps its capacity
+        std::size_t m_event_start { 0 }; // start of the event being accumulated
+        std::size_t m_line_start { 0 };  // start of the line being accumulated
+        std::size_t m_scan { 0 };        // first byte not yet checked for a line break
+    };
+} // namespace ida_re::api
@@ -0,0 +1,257 @@
+#include "vendor.hpp"
+
+#include "llm_api.hpp"
+
+namespace ida_re::api {
+    namespace {
+        // role markers and separators providers wrap around every message
+        constexpr std::size_t k_message_overhead = 8;
+
+        // share of the window held back for estimation error; the estimate already over-counts code
+        constexpr int k_margin_percent = 5;
+
+        // room left for the omission note clip( ) inserts
+        constexpr std::size_t k_clip_note_tokens = 24;
+
+        // a turn is not clipped below this; shrinking it further would leave nothing worth sending
+        constexpr std::size_t k_min_turn_tokens = 256;
+
+        constexpr bool is_word_char( unsigned char c ) noexcept {
+            return ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' ) || ( c >= '0' && c <= '9' ) || c == '_';
+        }
+
+        std::size_t message_cost( const message_t &message ) noexcept {
+            return estimate_tokens( message.m_content ) + k_message_overhead;
+        }
+
+        // moves a cut position back onto a UTF-8 sequence start, so clipped text still serializes as JSON
+        std::size_t utf8_floor( std::string_view text, std::size_t pos ) noexcept {
+            while ( pos > 0 && pos < text.size( ) && ( static_cast< unsigned char >( text[ pos ] ) & 0xC0 ) == 0x80 ) {
+                pos--;
+            }
+            return pos;
+        }
+    } // namespace
+
+    std::size_t estimate_tokens( std::string_view text ) noexcept {
+        std::size_t tokens = 0;
+
+        for ( std::size_t i = 0; i < text.size( ); ) {
+            const auto c = static_cast< unsigned char >( text[ i ] );
+
+            if ( is_word_char( c ) ) {
+                const auto start = i;
+                while ( i < text.size( ) && is_word_char( static_cast< unsigned char >( text[ i ] ) ) ) {
+                    i++;
+                }
+                tokens += ( i - start + 3 ) / 4;
+            } else if ( c == ' ' || c == '\t' ) {
+                // a single space merges into the next token; indentation runs cost about one
+                const auto start = i;
+                while ( i < text.size( ) && ( text[ i ] == ' ' || text[ i ] == '\t' ) ) {
+                    i++;
+                }
+                tokens += i - start > 1 ? 1 : 0;
+            } else if ( c == '\r' ) {
+                i++;
+            } else {
+                // newlines, punctuation and non-ASCII bytes
+                tokens++;
+                i++;
+            }
+        }
+
+        return tokens;
+    }
+
+    std::size_t estimate_tokens( const std::vector< message_t > &messages ) noexcept {
+        std::size_t tokens = 0;
+        for ( const auto &message : messages ) {
+            tokens += message_cost( message );
+        }
+        return tokens;
+    }
+
+    c_token_budget::c_token_budget( int context_window, int max_output_tokens, std::string_view system_prompt ) noexcept {
+        const int window = std::max( context_window, 0 );
+        const int reply  = std::clamp( max_output_tokens, 0, window / 2 );
+        const int margin = window * k_margin_percent / 100;
+
+        const std::size_t available = static_cast< std::size_t >( std::max( window - reply - margin, 0 ) );
+        const std::size_t system    = system_prompt.empty( ) ? 0 : estimate_tokens( system_prompt ) + k_message_overhead;
+        m_prompt_budget             = available > system ? available - system : 0;
+    }
+
+    bool c_token_budget::fits( std::string_view prompt ) const noexcept {
+        return estimate_tokens( prompt ) + k_message_overhead <= m_prompt_budget;
+    }
+
+    std::size_t c_token_budget::fit( std::vector< message_t > &messages ) const {
+        std::size_t total = estimate_tokens( messages );
+        if ( total <= m_prompt_budget )
+            return 0;
+
+        std::size_t opening = 0;
+        while ( opening < messages.size( ) && messages[ opening ].m_role == "system" ) {
+            opening++;
+        }
+        if ( opening == messages.size( ) )
+            return 0;
+
+        // drop the oldest assistant/user pairs after the opening turn, always keeping the latest turn
+        std::size_t drop_end = opening + 1;
+        while ( total > m_prompt_budget && messages.size( ) - drop_end >= 3 ) {
+            total    -= message_cost( messages[ drop_end ] ) + message_cost( messages[ drop_end + 1 ] );
+            drop_end += 2;
+        }
+
+        const std::size_t dropped = drop_end - opening - 1;
+        messages.erase( messages.begin( ) + static_cast< std::ptrdiff_t >( opening + 1 ), messages.begin( ) + static_cast< std::ptrdiff_t >( drop_end ) );
+
+        // still too large: the opening turn (usually the function context) gives way first, then the latest turn
+        const auto shrink = [ & ]( message_t &message ) {
+            if ( total <= m_prompt_budget )
+                return;
+
+            const auto cost   = message_cost( message );
+            const auto others = total - cost;
+            const auto room   = m_prompt_budget > others + k_message_overhead ? m_prompt_budget - others - k_message_overhead : 0;
+
+            message.m_content = clip( message.m_content, std::max( room, k_min_turn_tokens ) );
+            total             = others + message_cost( message );
+        };
+
+        shrink( messages[ opening ] );
+        if ( messages.size( ) - 1 != opening ) {
+            shrink( messages.back( ) );
+        }
+
+        return dropped;
+    }
+
+    std::string c_token_budget::clip( std::string_view text, std::size_t max_tokens ) {
+        if ( estimate_tokens( text ) <= max_tokens )
+            return std::string( text );
+
+        // every byte costs at most one token, so a partial line of n bytes never exceeds n tokens
+        const std::size_t room      = max_tokens > k_clip_note_tokens ? max_tokens - k_clip_note_tokens : 0;
+        const std::size_t head_room = room * 2 / 3;
+        const std::size_t tail_room = room - head_room;
+
+        std::size_t head_end = 0;
+        for ( std::size_t used = 0; head_end < text.size( ); ) {
+            const auto newline  = text.find( '\n', head_end );
+            const auto line_end = newline == std::string_view::npos ? text.size( ) : newline + 1;
+            const auto cost     = estimate_tokens( text.substr( head_end, line_end - head_end ) );
+
+            if ( used + cost > head_room ) {
+                if ( head_end == 0 ) // one oversized first line: keep a byte prefix of it
+                    head_end = utf8_floor( text, std::min( head_room, text.size( ) ) );
+                break;
+            }
+
+            used     += cost;
+            head_end  = line_end;
+        }
+
+        std::size_t tail_start = text.size( );
+        for ( std::size_t used = 0; tail_start > head_end; ) {
+            const auto newline    = tail_start >= 2 ? text.rfind( '\n', tail_start - 2 ) : std::string_view::npos;
+            const auto line_start = std::max( newline == std::string_view::npos ? 0 : newline + 1, head_end );
+            const auto cost       = estimate_tokens( text.substr( line_start, tail_start - line_start ) );
+
+            if ( used + cost > tail_room ) {
+                if ( tail_start == text.size( ) ) // one oversized last line: keep a byte suffix of it
+                    tail_start = utf8_floor( text, text.size( ) - std::min( tail_room, text.size( ) - head_end ) );
+                break;
+            }
+
+            used       += cost;
+            tail_start  = line_start;
+        }
+
+        const auto omitted       = text.substr( head_end, tail_start - head_end );
+        const auto omitted_lines = static_cast< std::size_t >( std::ranges::count( omitted, '\n' ) );
+
+        std::string clipped;
+        clipped.reserve( head_end + ( text.size( ) - tail_start ) + 96 );
+        clipped.append( text.substr( 0, head_end ) );
+        if ( !clipped.empty( ) && clipped.back( ) != '\n' )
+            clipped.push_back( '\n' );
+        clipped.append( "/* ... " + std::to_string( omitted_lines ) + " lines omitted to fit the model's context window ... */\n" );
+        clipped.append( text.substr( tail_start ) );
+        return clipped;
+    }
+
+    std::vector< std::string_view > c_token_budget::split( std::string_view code, std::size_t max_tokens ) {
+        enum e_cut_rank : int {
+            e_cut_none = -1,
+            e_cut_line,      // any line end
+            e_cut_paragraph, // blank line or label (LABEL_12:)
+            e_cut_statement  // statement or block closed at function-body depth
+        };
+
+        std::vector< std::string_view > chunks;
+        max_tokens = std::max( max_tokens, k_min_turn_tokens );
+
+        std::size_t chunk_start = 0;
+        std::size_t used        = 0;
+        std::size_t best_cut    = 0;
+        int         best_rank   = e_cut_none;
+        int         depth       = 0;
+
+        for ( std::size_t pos = 0; pos < code.size( ); ) {
+            const auto newline  = code.find( '\n', pos );
+            const auto line_end = newline == std::string_view::npos ? code.size( ) : newline + 1;
+            const auto line     = code.substr( pos, line_end - pos );
+            const auto cost     = estimate_tokens( line );
+
+            if ( used > 0 && used + cost > max_tokens ) {
+                const auto cut = best_rank != e_cut_none ? best_cut : pos;
+                chunks.push_back( code.substr( chunk_start, cut - chunk_start ) );
+
+                used        = estimate_tokens( code.substr( cut, pos - cut ) );
+                chunk_start = cut;
+                best_rank   = e_cut_none;
+            }
+
+            if ( used == 0 && cost > max_tokens ) {
+                chunks.push_back( line );
+                chunk_start = line_end;
+                pos         = line_end;
+                continue;
+            }
+
+            used += cost;
+            for ( const char c : line ) {
+                depth += c == '{' ? 1 : c == '}' ? -1 : 0;
+            }
+
+            // only the second half of a piece is considered, so good cuts never produce tiny pieces
+            if ( used >= max_tokens / 2 ) {
+                auto trimmed = line;
+                while ( !trimmed.empty( ) && std::isspace( static_cast< unsigned char >( trimmed.back( ) ) ) ) {
+                    trimmed.remove_suffix( 1 );
+                }
+
+                int rank = e_cut_line;
+                if ( depth <= 1 && !trimmed.empty( ) && ( trimmed.back( ) == ';' || trimmed.back( ) == '}' ) )
+                    rank = e_cut_statement;
+                else if ( trimmed.empty( ) || trimmed.back( ) == ':' )
+                    rank = e_cut_paragraph;
+
+                if ( rank >= best_rank ) {
+                    best_rank = rank;
+                    best_cut  = line_end;
+                }
+            }
+
+            pos = line_end;
+        }
+
+        if ( chunk_start < code.size( ) )
+            chunks.push_back( code.substr( chunk_start ) );
+
+        return chunks;
+    }
+} // namespace ida_re::api
@@ -0,0 +1,50 @@
+#pragma once
+
+namespace ida_re::api {
+    struct message_t;
+
+    // Local token estimate, deliberately on the high side of the BPE vocabularies in use (cl100k/o200k,
+    // Claude, Gemini) for decompiled C: identifier and number runs cost a token per 4 characters, other
+    // printable bytes a token each, single spaces nothing. One pass, no allocation.
+    [[nodiscard]] std::size_t estimate_tokens( std::string_view text ) noexcept;
+
+    // Includes the per-message framing (role markers) every provider adds
+    [[nodiscard]] std::size_t estimate_tokens( const std::vector< message_t > &messages ) noexcept;
+
+    // Splits a model's context window into room for the reply, a margin for estimation error, the
+    // client's system prompt (sent with every request) and the prompt budget, and shrinks requests to
+    // fit it so they are never rejected for size and the reply is never cut short by the window
+    // instead of by max_tokens.
+    class c_token_budget {
+      public:
+        c_token_budget( int context_window, int max_output_tokens, std::string_view system_prompt = { } ) noexcept;
+
+        [[nodiscard]] std::size_t prompt_budget( ) const noexcept {
+            return m_prompt_budget;
+        }
+
+        [[nodiscard]] bool fits( const std::vector< message_t > &messages ) const noexcept {
+            return estimate_tokens( messages ) <= m_prompt_budget;
+        }
+
+        // a single-message prompt
+        [[nodiscard]] bool fits( std::string_view prompt ) const noexcept;
+
+        // Drops the oldest turns between the opening (context) turn and the latest one, in assistant/user
+        // pairs so roles keep alternating, then clips the opening and the latest turn if that was not
+        // enough. Leading system messages are kept. Returns the number of turns dropped.
+        std::size_t fit( std::vector< message_t > &messages ) const;
+
+        // Shortens text to about max_tokens, keeping whole lines from the head and the tail around a note
+        // saying how many lines were left out. Text that already fits is returned unchanged.
+        [[nodiscard]] static std::string clip( std::string_view text, std::size_t max_tokens );
+
+        // Splits pseudocode into consecutive pieces of about max_tokens each. Cuts go after a statement at
+        // function-body level where possible, then after a blank or label line, and only then at any line
+        // end; a single line larger than max_tokens becomes a piece of its own.
+        [[nodiscard]] static std::vector< std::string_view > split( std::string_view code, std::size_t max_tokens );
+
+      private:
+        std::size_t m_prompt_budget { 0 };
+    };
+} // namespace ida_re::api
@@ -11,6 +11,13 @@ namespace ida_re::core {
         bool        m_openrouter_free_only { true };
         std::string m_model { "gemini-2.0-flash-exp" };
         int         m_max_tokens { 4096 };
+        bool        m_claude_prompt_caching { false }; // cache_control breakpoints on the system prompt and function context
+        int         m_requests_per_minute { 0 };       // client-side throttle for the selected provider, 0 = unlimited
+        int         m_tokens_per_minute { 0 };         // estimated prompt tokens per minute, 0 = unlimited
+        int         m_max_retries { 3 };               // retries on 429/529/5xx and connection failures
+        std::string m_hedge_provider { };              // backup raced against a slow provider, empty = off
+        std::string m_hedge_model { };                 // backup provider's model, empty = its default
+        int         m_hedge_delay_ms { 5000 };         // wait for the first token before asking the backup
 
         // Custom API endpoints
         std::string m_openai_base_url { };
@@ -19,6 +26,8 @@ namespace ida_re::core {
         // IDA MCP settings
         std::string m_mcp_host { "127.0.0.1" };
         int         m_mcp_port { 13120 };
+        int         m_mcp_pool_size { 4 };       // max keep-alive connections to the plugin
+        int         m_mcp_idle_timeout { 30 };   // seconds before an idle connection is closed
 
         // UI settings
         bool  m_auto_connect { false };
@@ -26,6 +35,8 @@ namespace ida_re::core {
 
         // Cache settings
         bool m_enable_cache { true };
+        int  m_analysis_cache_mb { 256 }; // parsed results kept in memory by each analysis cache, 0 = unbounded
+        int  m_xref_preview_cache_mb { 8 };
 
         [[nodiscard]] static std::filesystem::path get_config_dir( ) {
 #ifdef IDA_RE_PLATFORM_WINDOWS
@@ -46,6 +57,19 @@ namespace ida_re::core {
         }
 
         [[nodiscard]] static std::filesystem::path get_cache_path( ) {
+            return get_config_dir( ) / "analysis_cache.bin";
+        }
+
+        [[nodiscard]] static std::filesystem::path get_content_cache_path( ) {
+            return get_config_dir( ) / "analysis_content_cache.bin";
+        }
+
+        [[nodiscard]] static std::filesystem::path get_similarity_index_path( ) {
+            return get_config_dir( ) / "similar_functions.jsonl";
+        }
+
+        // JSON cache written by earlier versions; imported once into the binary cache
+        [[nodiscard]] static std::filesystem::path get_legacy_cache_path( ) {
             return get_config_dir( ) / "analysis_cache.json";
         }
 
@@ -58,21 +82,32 @@ namespace ida_re::core {
                 std::ifstream f( path );
                 json_t        j = json_t::parse( f );
 
-                m_provider             = j.value( "provider", "gemini" );
-                m_claude_api_key       = j.value( "claude_api_key", j.value( "api_key", "" ) ); // backward compat
-                m_openai_api_key       = j.value( "openai_api_key", "" );
-                m_gemini_api_key       = j.value( "gemini_api_key", "" );
-                m_openrouter_api_key   = j.value( "openrouter_api_key", "" );
-                m_openrouter_free_only = j.value( "openrouter_free_only", true );
-                m_model                = j.value( "model", "gemini-2.0-flash-exp" );
-                m_max_tokens           = j.value( "max_tokens", 4096 );
-                m_openai_base_url      = j.value( "openai_base_url", "" );
-                m_anthropic_base_url   = j.value( "anthropic_base_url", "" );
-                m_mcp_host             = j.value( "mcp_host", "127.0.0.1" );
-                m_mcp_port             = j.value( "mcp_port", 13120 );
-                m_auto_connect         = j.value( "auto_connect", false );
-                m_ui_scale             = j.value( "ui_scale", 1.0f );
-                m_enable_cache         = j.value( "enable_cache", true );
+                m_provider              = j.value( "provider", "gemini" );
+                m_claude_api_key        = j.value( "claude_api_key", j.value( "api_key", "" ) ); // backward compat
+                m_openai_api_key        = j.value( "openai_api_key", "" );
+                m_gemini_api_key        = j.value( "gemini_api_key", "" );
+                m_openrouter_api_key    = j.value( "openrouter_api_key", "" );
+                m_openrouter_free_only  = j.value( "openrouter_free_only", true );
+                m_model                 = j.value( "model", "gemini-2.0-flash-exp" );
+                m_max_tokens            = j.value( "max_tokens", 4096 );
+                m_claude_prompt_caching = j.value( "claude_prompt_caching", false );
+                m_requests_per_minute   = j.value( "requests_per_minute", 0 );
+                m_tokens_per_minute     = j.value( "tokens_per_minute", 0 );
+                m_max_retries           = j.value( "max_retries", 3 );
+                m_hedge_provider        = j.value( "hedge_provider", "" );
+                m_hedge_model           = j.value( "hedge_model", "" );
+                m_hedge_delay_ms        = j.value( "hedge_delay_ms", 5000 );
+                m_openai_base_url       = j.value( "openai_base_url", "" );
+                m_anthropic_base_url    = j.value( "anthropic_base_url", "" );
+                m_mcp_host              = j.value( "mcp_host", "127.0.0.1" );
+                m_mcp_port              = j.value( "mcp_port", 13120 );
+                m_mcp_pool_size         = j.value( "mcp_pool_size", 4 );
+                m_mcp_idle_timeout      = j.value( "mcp_idle_timeout", 30 );
+                m_auto_connect          = j.value( "auto_connect", false );
+                m_ui_scale              = j.value( "ui_scale", 1.0f );
+                m_enable_cache          = j.value( "enable_cache", true );
+                m_analysis_cache_mb     = j.value( "analysis_cache_mb", 256 );
+                m_xref_preview_cache_mb = j.value( "xref_preview_cache_mb", 8 );
 
                 return true;
             } catch ( ... ) {
@@ -95,13 +130,24 @@ namespace ida_re::core {
                     {  "openrouter_free_only",  m_openrouter_free_only },
                     {               "model",               m_model },
                     {          "max_tokens",          m_max_tokens },
+                    { "claude_prompt_caching", m_claude_prompt_caching },
+                    {   "requests_per_minute",   m_requests_per_minute },
+                    {     "tokens_per_minute",     m_tokens_per_minute },
+                    {           "max_retries",           m_max_retries },
+                    {        "hedge_provider",        m_hedge_provider },
+                    {           "hedge_model",           m_hedge_model },
+                    {        "hedge_delay_ms",        m_hedge_delay_ms },
                     {     "openai_base_url",     m_openai_base_url },
                     { "anthropic_base_url", m_anthropic_base_url },
                     {            "mcp_host",            m_mcp_host },
                     {            "mcp_port",            m_mcp_port },
+                    {       "mcp_pool_size",       m_mcp_pool_size },
+                    {    "mcp_idle_timeout",    m_mcp_idle_timeout },
                     {        "auto_connect",        m_auto_connect },
                     {            "ui_scale",            m_ui_scale },
-                    {        "enable_cache",        m_enable_cache }
+                    {        "enable_cache",        m_enable_cache },
+                    {     "analysis_cache_mb",     m_analysis_cache_mb },
+                    { "xref_preview_cache_mb", m_xref_preview_cache_mb }
                 };
 
                 std::ofstream f( path );
@@ -86,6 +86,8 @@ int WINAPI WinMain( HINSTANCE hInstance, HINSTANCE, LPSTR, int ) {
     ida_re::api::c_mcp_client mcp;
     mcp.set_host( config.m_mcp_host );
     mcp.set_port( config.m_mcp_port );
+    mcp.set_pool_size( static_cast< std::size_t >( std::max( config.m_mcp_pool_size, 1 ) ) );
+    mcp.set_idle_timeout( std::chrono::seconds( config.m_mcp_idle_timeout ) );
 
     ida_re::api::c_llm_manager llm_manager;
 
@@ -95,16 +97,23 @@ int WINAPI WinMain( HINSTANCE hInstance, HINSTANCE, LPSTR, int ) {
         llm_manager.claude( ).set_api_key( config.m_claude_api_key );
         llm_manager.claude( ).set_model( config.m_model );
         llm_manager.claude( ).set_max_tokens( config.m_max_tokens );
+        llm_manager.claude( ).set_prompt_caching( config.m_claude_prompt_caching );
+        llm_manager.claude( ).set_rate_limits( config.m_requests_per_minute, config.m_tokens_per_minute );
+        llm_manager.claude( ).set_max_retries( config.m_max_retries );
     } else if ( config.m_provider == "openai" ) {
         llm_manager.set_provider( ida_re::api::e_provider::openai );
         llm_manager.openai( ).set_api_key( config.m_openai_api_key );
         llm_manager.openai( ).set_model( config.m_model );
         llm_manager.openai( ).set_max_tokens( config.m_max_tokens );
+        llm_manager.openai( ).set_rate_limits( config.m_requests_per_minute, config.m_tokens_per_minute );
+        llm_manager.openai( ).set_max_retries( config.m_max_retries );
     } else {
         llm_manager.set_provider( ida_re::api::e_provider::gemini );
         llm_manager.gemini( ).set_api_key( config.m_gemini_api_key );
         llm_manager.gemini( ).set_model( config.m_model );
         llm_manager.gemini( ).set_max_tokens( config.m_max_tokens );
+        llm_manager.gemini( ).set_rate_limits( config.m_requests_per_minute, config.m_tokens_per_minute );
+        llm_manager.gemini( ).set_max_retries( config.m_max_retries );
     }
 
     ida_re::ui::c_ui ui;
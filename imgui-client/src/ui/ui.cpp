@@ -3,6 +3,17 @@
 #include "ui.hpp"
 
 namespace ida_re::ui {
+    namespace {
+        // lowercase "address\nname"; the separator keeps a filter from matching across the two fields
+        std::string make_search_key( const api::mcp_function_t &function ) {
+            std::string key;
+            key.reserve( function.m_address.size( ) + function.m_name.size( ) + 1 );
+            key.append( function.m_address ).append( 1, '\n' ).append( function.m_name );
+            std::transform( key.begin( ), key.end( ), key.begin( ), ::tolower );
+            return key;
+        }
+    } // namespace
+
     c_ui::c_ui( ) { }
 
     c_ui::~c_ui( ) {
@@ -14,20 +25,26 @@ namespace ida_re::ui {
         m_history.load_from_file( utils::c_analysis_history::get_default_history_path( ) );
         m_highlighter.set_color_scheme( utils::c_syntax_highlighter::ios_dark_theme( ) );
         load_cache( );
+        apply_cache_limits( );
         load_bookmarks( );
         load_custom_prompts( );
         load_pinned_functions( );
+        apply_hedge_to_llm( );
     }
 
     void c_ui::shutdown( ) {
         m_chat_loading     = false;
         m_analysis_loading = false;
+        if ( m_analysis_request )
+            m_analysis_request->cancel( );
         if ( m_chat_thread.joinable( ) )
             m_chat_thread.join( );
         if ( m_analysis_thread.joinable( ) )
             m_analysis_thread.join( );
         m_history.save_to_file( utils::c_analysis_history::get_default_history_path( ) );
-        save_cache( );
+        m_analysis_cache.close( );
+        m_content_cache.close( );
+        m_similarity_index.close( );
     }
 
     void c_ui::apply_style( ) {
@@ -87,6 +104,10 @@ namespace ida_re::ui {
     }
 
     void c_ui::render( ) {
+        // deliver finished MCP requests before drawing so this frame sees their results
+        if ( m_mcp )
+            m_mcp->poll_completions( );
+
         render_menu_bar( );
 
         ImGuiViewport *viewport = ImGui::GetMainViewport( );
@@ -202,7 +223,8 @@ namespace ida_re::ui {
                     apply_light_theme( );
                 }
                 ImGui::Separator( );
-                if ( ImGui::MenuItem( "Clear Chat" ) ) {
+                if ( ImGui::MenuItem( "Clear Chat" ) && !m_chat_loading ) {
+                    std::lock_guard< std::mutex > lock( m_chat_mutex );
                     m_chat_history.clear( );
                 }
                 ImGui::EndMenu( );
@@ -265,30 +287,28 @@ namespace ida_re::ui {
             ImGui::TextDisabled( "%s:%d", m_config->m_mcp_host.c_str( ), m_config->m_mcp_port );
         }
 
-        ImGui::BeginDisabled( connected );
-        if ( ImGui::Button( "Connect", ImVec2( 100, 0 ) ) ) {
+        ImGui::BeginDisabled( connected || m_connecting );
+        if ( ImGui::Button( m_connecting ? "Connecting..." : "Connect", ImVec2( 100, 0 ) ) ) {
             if ( m_mcp && m_config ) {
                 m_mcp->set_host( m_config->m_mcp_host );
                 m_mcp->set_port( m_config->m_mcp_port );
-                if ( m_mcp->connect( ) ) {
-                    // Get database info for cache key
-                    auto db_info = m_mcp->get_database_info( );
-                    if ( db_info.m_success ) {
-                        m_current_file_md5  = db_info.m_data.value( "md5", "Unknown" );
-                        m_current_file_name = db_info.m_data.value( "input_file_name", "Unknown" );
-                    } else {
-                        m_current_file_md5  = "Unknown";
-                        m_current_file_name = "Unknown";
-                    }
-
-                    auto result = m_mcp->list_functions( 500 );
-                    if ( result.m_success && result.m_data.contains( "functions" ) ) {
-                        m_function_list.clear( );
-                        for ( const auto &f : result.m_data[ "functions" ] ) {
-                            m_function_list.push_back( { f.value( "address", "" ), f.value( "name", "" ) } );
+                m_connecting = true;
+                m_connection_error.clear( );
+
+                m_mcp->submit(
+                    []( api::c_mcp_client &mcp ) {
+                        connect_result_t result;
+                        result.m_connected = mcp.connect( );
+                        if ( !result.m_connected ) {
+                            result.m_error = mcp.get_last_error( );
+                            return result;
                         }
-                    }
-                }
+
+                        // Get database info for cache key
+                        result.m_db_info = mcp.get_database_info( );
+                        return result;
+                    },
+                    [ this ]( connect_result_t result ) { apply_connect_result( std::move( result ) ); } );
             }
         }
         ImGui::EndDisabled( );
@@ -299,10 +319,37 @@ namespace ida_re::ui {
         if ( ImGui::Button( "Disconnect", ImVec2( 100, 0 ) ) ) {
             if ( m_mcp )
                 m_mcp->disconnect( );
-            m_function_list.clear( );
+            clear_function_list( );
             m_current_func = function_data_t( );
+            ++m_code_version;
+            ++m_function_list_generation;
+            m_functions_streaming = false;
+            m_function_total      = 0;
+            ++m_load_generation;
+            m_function_loading = false;
         }
         ImGui::EndDisabled( );
+
+        if ( !m_connection_error.empty( ) && !connected ) {
+            ImGui::TextColored( ImVec4( 1.0f, 0.6f, 0.4f, 1.0f ), "%s", m_connection_error.c_str( ) );
+        }
+
+        if ( m_mcp ) {
+            const auto stats = m_mcp->get_stats( );
+            if ( stats.m_requests > 0 ) {
+                ImGui::TextDisabled( "%llu calls, avg %.1f ms, max %.1f ms", static_cast< unsigned long long >( stats.m_requests ),
+                                     stats.average_ms( ), stats.m_max_ms );
+                if ( ImGui::IsItemHovered( ) ) {
+                    ImGui::BeginTooltip( );
+                    ImGui::Text( "Last call: %.1f ms", stats.m_last_ms );
+                    ImGui::Text( "Failed calls: %llu", static_cast< unsigned long long >( stats.m_failures ) );
+                    ImGui::Text( "Connections opened: %llu", static_cast< unsigned long long >( stats.m_opened ) );
+                    ImGui::Text( "Connections reused: %llu", static_cast< unsigned long long >( stats.m_reused ) );
+                    ImGui::Text( "Idle connections closed: %llu", static_cast< unsigned long long >( stats.m_evicted ) );
+                    ImGui::EndTooltip( );
+                }
+            }
+        }
     }
 
     void c_ui::render_function_panel( ) {
@@ -318,16 +365,21 @@ namespace ida_re::ui {
         ImGui::SameLine( );
         if ( ImGui::Button( "Current", ImVec2( 80, 0 ) ) ) {
             if ( m_mcp && m_mcp->is_connected( ) ) {
-                auto result = m_mcp->get_current_function( );
-                if ( result.m_success ) {
-                    std::string addr = result.m_data.value( "address", "" );
-                    if ( !addr.empty( ) ) {
-                        strncpy( m_address_input, addr.c_str( ), sizeof( m_address_input ) - 1 );
-                        load_function( addr );
+                m_mcp->call_tool_async( "get_current_function", json_t::object( ), [ this ]( api::mcp_tool_result_t result ) {
+                    if ( result.m_success ) {
+                        std::string addr = result.m_data.value( "address", "" );
+                        if ( !addr.empty( ) ) {
+                            strncpy( m_address_input, addr.c_str( ), sizeof( m_address_input ) - 1 );
+                            load_function( addr );
+                        }
                     }
-                }
+                } );
             }
         }
+        if ( m_function_loading ) {
+            ImGui::SameLine( );
+            ImGui::TextDisabled( "Loading..." );
+        }
 
         ImGui::Separator( );
 
@@ -335,39 +387,53 @@ namespace ida_re::ui {
         ImGui::Text( "Search:" );
         ImGui::SameLine( );
         ImGui::SetNextItemWidth( -1 );
-        ImGui::InputText( "##filter", m_function_filter, sizeof( m_function_filter ) );
-
-        // Function list
-        ImGui::BeginChild( "##funclist", ImVec2( 0, 0 ), false );
+        if ( ImGui::InputText( "##filter", m_function_filter, sizeof( m_function_filter ) ) ) {
+            m_function_filter_dirty = true;
+            m_fuzzy_search.search( m_function_filter );
+        }
 
-        std::string filter_lower = m_function_filter;
-        std::transform( filter_lower.begin( ), filter_lower.end( ), filter_lower.begin( ), ::tolower );
+        update_function_filter( );
 
-        int visible_count = 0;
-        for ( const auto &[ addr, name ] : m_function_list ) {
-            if ( filter_lower.length( ) > 0 ) {
-                std::string addr_lower = addr;
-                std::string name_lower = name;
-                std::transform( addr_lower.begin( ), addr_lower.end( ), addr_lower.begin( ), ::tolower );
-                std::transform( name_lower.begin( ), name_lower.end( ), name_lower.begin( ), ::tolower );
-                if ( addr_lower.find( filter_lower ) == std::string::npos && name_lower.find( filter_lower ) == std::string::npos ) {
-                    continue;
-                }
+        // use the ranked results only when they belong to the current list and filter; until the worker
+        // catches up the substring matches are shown instead
+        std::shared_ptr< const utils::c_fuzzy_search::results_t > fuzzy { };
+        if ( m_function_filter[ 0 ] != '\0' && m_fuzzy_generation != 0 ) {
+            if ( auto results = m_fuzzy_search.results( );
+                 results && results->m_index_generation == m_fuzzy_generation && results->m_pattern == m_function_filter ) {
+                fuzzy = std::move( results );
             }
-            visible_count++;
+        }
+
+        const auto visible_count = fuzzy ? fuzzy->m_matches.size( ) : m_filtered_functions.size( );
+
+        // Function list; only the visible rows are submitted
+        ImGui::BeginChild( "##funclist", ImVec2( 0, 0 ), false );
+
+        ImGuiListClipper clipper;
+        clipper.Begin( static_cast< int >( visible_count ) );
+        while ( clipper.Step( ) ) {
+            for ( int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++ ) {
+                const auto index                 = fuzzy ? fuzzy->m_matches[ row ].m_index : m_filtered_functions[ row ];
+                const auto &[ addr, name, size ] = m_function_list[ index ];
 
-            char label[ 512 ];
-            snprintf( label, sizeof( label ), "%s: %s", addr.c_str( ), name.c_str( ) );
+                char label[ 512 ];
+                snprintf( label, sizeof( label ), "%s: %s", addr.c_str( ), name.c_str( ) );
 
-            if ( ImGui::Selectable( label, m_current_func.m_address == addr ) ) {
-                strncpy( m_address_input, addr.c_str( ), sizeof( m_address_input ) - 1 );
-                load_function( addr );
+                if ( ImGui::Selectable( label, m_current_func.m_address == addr ) ) {
+                    strncpy( m_address_input, addr.c_str( ), sizeof( m_address_input ) - 1 );
+                    load_function( addr );
+                }
             }
         }
+        clipper.End( );
 
         ImGui::EndChild( );
 
-        ImGui::Text( "Functions: %d / %zu", visible_count, m_function_list.size( ) );
+        ImGui::Text( "Functions: %zu / %zu", visible_count, m_function_list.size( ) );
+        if ( m_functions_streaming ) {
+            ImGui::SameLine( );
+            ImGui::TextDisabled( "(loading %zu / %zu)", m_function_list.size( ), m_function_total );
+        }
     }
 
     void c_ui::render_analysis_panel( ) {
@@ -388,9 +454,11 @@ namespace ida_re::ui {
                         ImGui::TextDisabled( "Let AI rename vars & add comments" );
                     }
 
+                    render_similar_functions( );
+
                     ImGui::Separator( );
                     ImGui::BeginChild( "##pseudo_scroll" );
-                    m_highlighter.render_text( m_current_func.m_pseudocode, true );
+                    m_highlighter.render_text( m_current_func.m_pseudocode, true, m_code_version );
                     ImGui::EndChild( );
                 } else {
                     ImGui::TextDisabled( "No function loaded" );
@@ -402,7 +470,7 @@ namespace ida_re::ui {
                 m_current_tab = 1;
                 if ( m_current_func.m_loaded ) {
                     ImGui::BeginChild( "##asm_scroll" );
-                    m_highlighter.render_assembly( m_current_func.m_assembly, true );
+                    m_highlighter.render_assembly( m_current_func.m_assembly, true, m_code_version );
                     ImGui::EndChild( );
                 } else {
                     ImGui::TextDisabled( "No function loaded" );
@@ -422,29 +490,14 @@ namespace ida_re::ui {
 
                         bool clicked = ImGui::Selectable( x.c_str( ), false, ImGuiSelectableFlags_AllowDoubleClick );
 
-                        // Prefetch preview when hovering starts (before tooltip)
+                        // Prefetch preview when hovering starts (before tooltip); the request runs in the
+                        // background and the tooltip shows "Loading preview..." until it lands
                         if ( ImGui::IsItemHovered( ImGuiHoveredFlags_DelayNone ) ) {
-                            if ( m_xref_preview_cache.find( x ) == m_xref_preview_cache.end( ) ) {
+                            if ( !m_xref_preview_cache.contains( x ) && !m_xref_preview_pending.contains( x ) ) {
                                 if ( m_mcp && m_mcp->is_connected( ) ) {
-                                    auto result = m_mcp->get_function_pseudocode( x );
-                                    if ( result.m_success && result.m_data.contains( "pseudocode" ) ) {
-                                        std::string preview = result.m_data[ "pseudocode" ].get< std::string >( );
-                                        // Limit preview to first 5 lines
-                                        size_t count = 0;
-                                        size_t pos   = 0;
-                                        while ( count < 5 && ( pos = preview.find( '\n', pos ) ) != std::string::npos ) {
-                                            pos++;
-                                            count++;
-                                        }
-                                        if ( pos != std::string::npos ) {
-                                            preview = preview.substr( 0, pos ) + "\n...";
-                                        }
-                                        m_xref_preview_cache[ x ] = preview;
-                                    } else {
-                                        m_xref_preview_cache[ x ] = "Preview not available";
-                                    }
+                                    request_xref_preview( x );
                                 } else {
-                                    m_xref_preview_cache[ x ] = "Not connected to IDA";
+                                    m_xref_preview_cache.put( x, "Not connected to IDA", 0 );
                                 }
                             }
                         }
@@ -462,8 +515,8 @@ namespace ida_re::ui {
                             ImGui::TextColored( ImVec4( 0.8f, 0.9f, 0.6f, 1.0f ), "%s", x.c_str( ) );
                             ImGui::Separator( );
 
-                            if ( m_xref_preview_cache.find( x ) != m_xref_preview_cache.end( ) ) {
-                                ImGui::TextWrapped( "%s", m_xref_preview_cache[ x ].c_str( ) );
+                            if ( const auto *preview = m_xref_preview_cache.find( x ) ) {
+                                ImGui::TextWrapped( "%s", preview->c_str( ) );
                             } else {
                                 ImGui::TextDisabled( "Loading preview..." );
                             }
@@ -517,6 +570,17 @@ namespace ida_re::ui {
                     m_show_history = true;
                 }
 
+                api::token_usage_t usage;
+                {
+                    std::lock_guard< std::mutex > lock( m_chat_mutex );
+                    usage = m_analysis_usage;
+                }
+                if ( usage.total( ) > 0 ) {
+                    ImGui::SameLine( );
+                    ImGui::TextDisabled( "Tokens: %d in (%d cache read, %d cache write) / %d out", usage.prompt( ), usage.m_cache_read,
+                                         usage.m_cache_write, usage.m_output );
+                }
+
                 ImGui::Separator( );
 
                 // Display chat history
@@ -580,7 +644,15 @@ namespace ida_re::ui {
                 }
 
                 if ( m_analysis_loading ) {
-                    ImGui::TextDisabled( "Thinking..." );
+                    std::lock_guard< std::mutex > lock( m_chat_mutex );
+                    if ( !m_analysis_streaming_buffer.empty( ) ) {
+                        ImGui::PushStyleColor( ImGuiCol_Text, ImVec4( 0.8f, 1.0f, 0.8f, 1.0f ) );
+                        ImGui::Text( "AI" );
+                        ImGui::PopStyleColor( );
+                        m_highlighter.render_markdown( m_analysis_streaming_buffer );
+                    } else {
+                        ImGui::TextDisabled( "Thinking..." );
+                    }
                 }
 
                 ImGui::EndChild( );
@@ -602,18 +674,18 @@ namespace ida_re::ui {
                 }
 
                 if ( m_current_func.m_loaded && !m_analysis_loading ) {
-                    // Check if cached results exist
-                    bool has_general_cache = false;
-                    bool has_vuln_cache    = false;
-                    bool has_naming_cache  = false;
-
-                    if ( !m_current_file_md5.empty( ) && m_analysis_cache.find( m_current_file_md5 ) != m_analysis_cache.end( )
-                         && m_analysis_cache[ m_current_file_md5 ].find( m_current_func.m_address )
-                                != m_analysis_cache[ m_current_file_md5 ].end( ) ) {
-                        auto &func_cache  = m_analysis_cache[ m_current_file_md5 ][ m_current_func.m_address ];
-                        has_general_cache = func_cache.find( "general" ) != func_cache.end( );
-                        has_vuln_cache    = func_cache.find( "vulnerability" ) != func_cache.end( );
-                        has_naming_cache  = func_cache.find( "naming" ) != func_cache.end( );
+                    // Check if cached results exist: the same lookup perform_analysis( ) serves them from
+                    bool        has_general_cache = false;
+                    bool        has_vuln_cache    = false;
+                    bool        has_naming_cache  = false;
+                    std::string identity;
+
+                    if ( m_llm ) {
+                        const auto &content_key = current_content_key( );
+                        identity                = current_prompt_identity( );
+                        has_general_cache       = m_content_cache.contains( content_key, identity, "general" );
+                        has_vuln_cache          = m_content_cache.contains( content_key, identity, "vulnerability" );
+                        has_naming_cache        = m_content_cache.contains( content_key, identity, "naming" );
                     }
 
                     // Analyze button
@@ -625,7 +697,7 @@ namespace ida_re::ui {
                             m_pending_analysis_type = "general";
                             m_show_cache_popup      = true;
                         } else {
-                            perform_analysis( "general", true );
+                            perform_analysis( "general" );
                         }
                     }
                     if ( has_general_cache ) {
@@ -645,7 +717,7 @@ namespace ida_re::ui {
                             m_pending_analysis_type = "vulnerability";
                             m_show_cache_popup      = true;
                         } else {
-                            perform_analysis( "vulnerability", true );
+                            perform_analysis( "vulnerability" );
                         }
                     }
                     if ( has_vuln_cache ) {
@@ -665,7 +737,7 @@ namespace ida_re::ui {
                             m_pending_analysis_type = "naming";
                             m_show_cache_popup      = true;
                         } else {
-                            perform_analysis( "naming", true );
+                            perform_analysis( "naming" );
                         }
                     }
                     if ( has_naming_cache ) {
@@ -681,8 +753,10 @@ namespace ida_re::ui {
                         ImGui::TextDisabled( "|" );
                         ImGui::SameLine( );
                         if ( ImGui::Button( "Clear Cache" ) ) {
+                            m_content_cache.erase( current_content_key( ), identity );
                             if ( !m_current_file_md5.empty( ) ) {
-                                m_analysis_cache[ m_current_file_md5 ][ m_current_func.m_address ].clear( );
+                                m_analysis_cache.erase( m_current_file_md5, m_current_func.m_address );
+                                m_similarity_index.erase( m_current_file_md5, m_current_func.m_address );
                             }
                         }
                         if ( ImGui::IsItemHovered( ) ) {
@@ -847,6 +921,7 @@ namespace ida_re::ui {
         ImGui::Separator( );
 
         ImGui::BeginChild( "##chat_messages", ImVec2( 0, -30 ), false );
+        std::unique_lock< std::mutex > lock( m_chat_mutex );
         for ( const auto &msg : m_chat_history ) {
             if ( msg.m_is_user ) {
                 ImGui::TextColored( ImVec4( 0.6f, 0.8f, 1.0f, 1.0f ), "You:" );
@@ -869,6 +944,7 @@ namespace ida_re::ui {
                 ImGui::TextDisabled( "Thinking..." );
             }
         }
+        lock.unlock( );
 
         if ( ImGui::GetScrollY( ) >= ImGui::GetScrollMaxY( ) ) {
             ImGui::SetScrollHereY( 1.0f );
@@ -914,6 +990,10 @@ namespace ida_re::ui {
                 m_anthropic_base_url_buf[ sizeof( m_anthropic_base_url_buf ) - 1 ] = '\0';
                 strncpy( m_mcp_host_buf, m_config->m_mcp_host.c_str( ), sizeof( m_mcp_host_buf ) - 1 );
                 m_mcp_host_buf[ sizeof( m_mcp_host_buf ) - 1 ] = '\0';
+                strncpy( m_hedge_model_buf, m_config->m_hedge_model.c_str( ), sizeof( m_hedge_model_buf ) - 1 );
+                m_hedge_model_buf[ sizeof( m_hedge_model_buf ) - 1 ] = '\0';
+                const auto hedge        = api::provider_from_string( m_config->m_hedge_provider );
+                m_hedge_selected        = hedge ? static_cast< int >( *hedge ) + 1 : 0;
                 m_mcp_port_buf          = m_config->m_mcp_port;
                 m_openrouter_free_only  = m_config->m_openrouter_free_only;
                 m_settings_initialized  = true;
@@ -1098,6 +1178,67 @@ namespace ida_re::ui {
             ImGui::SetNextItemWidth( -1 );
             ImGui::InputInt( "##mcp_port", &m_mcp_port_buf );
 
+            if ( m_config ) {
+                ImGui::Text( "Connection Pool:" );
+                ImGui::SetNextItemWidth( -1 );
+                if ( ImGui::InputInt( "##mcp_pool_size", &m_config->m_mcp_pool_size ) ) {
+                    m_config->m_mcp_pool_size = std::clamp( m_config->m_mcp_pool_size, 1, 16 );
+                }
+                ImGui::TextDisabled( "Keep-alive connections kept open to the IDA plugin" );
+            }
+
+            ImGui::Spacing( );
+            ImGui::Text( "Rate Limits" );
+            ImGui::Separator( );
+
+            if ( m_config ) {
+                ImGui::TextDisabled( "Match your provider tier so batch analysis never trips its throttle (0 = unlimited)" );
+
+                ImGui::Text( "Requests per minute:" );
+                ImGui::SetNextItemWidth( -1 );
+                if ( ImGui::InputInt( "##requests_per_minute", &m_config->m_requests_per_minute ) ) {
+                    m_config->m_requests_per_minute = std::max( m_config->m_requests_per_minute, 0 );
+                }
+
+                ImGui::Text( "Tokens per minute:" );
+                ImGui::SetNextItemWidth( -1 );
+                if ( ImGui::InputInt( "##tokens_per_minute", &m_config->m_tokens_per_minute, 1000, 10000 ) ) {
+                    m_config->m_tokens_per_minute = std::max( m_config->m_tokens_per_minute, 0 );
+                }
+
+                ImGui::Text( "Retries:" );
+                ImGui::SetNextItemWidth( -1 );
+                if ( ImGui::InputInt( "##max_retries", &m_config->m_max_retries ) ) {
+                    m_config->m_max_retries = std::clamp( m_config->m_max_retries, 0, 10 );
+                }
+                ImGui::TextDisabled( "Throttled and overloaded requests are retried with backoff" );
+            }
+
+            ImGui::Spacing( );
+            ImGui::Text( "Backup Provider" );
+            ImGui::Separator( );
+
+            if ( m_config ) {
+                ImGui::TextDisabled( "Asked as well when the selected provider is slow to answer; the first to reply wins" );
+
+                static constexpr std::array backups = { "Off", "Claude", "OpenAI", "Gemini", "OpenRouter" };
+                ImGui::SetNextItemWidth( -1 );
+                ImGui::Combo( "##hedge_provider", &m_hedge_selected, backups.data( ), static_cast< int >( backups.size( ) ) );
+
+                if ( m_hedge_selected != 0 ) {
+                    ImGui::Text( "Backup model:" );
+                    ImGui::SetNextItemWidth( -1 );
+                    ImGui::InputTextWithHint( "##hedge_model", "provider default", m_hedge_model_buf, sizeof( m_hedge_model_buf ) );
+
+                    ImGui::Text( "Wait for first token (ms):" );
+                    ImGui::SetNextItemWidth( -1 );
+                    if ( ImGui::InputInt( "##hedge_delay_ms", &m_config->m_hedge_delay_ms, 500, 1000 ) ) {
+                        m_config->m_hedge_delay_ms = std::clamp( m_config->m_hedge_delay_ms, 0, 60000 );
+                    }
+                    ImGui::TextDisabled( "Uses the API key saved for the backup provider" );
+                }
+            }
+
             ImGui::Spacing( );
             ImGui::Text( "Custom API Endpoints" );
             ImGui::Separator( );
@@ -1135,6 +1276,9 @@ namespace ida_re::ui {
             if ( m_config ) {
                 ImGui::Checkbox( "Enable Analysis Cache", &m_config->m_enable_cache );
                 ImGui::TextDisabled( "Cache saves API tokens by storing analysis results" );
+
+                ImGui::Checkbox( "Claude Prompt Caching", &m_config->m_claude_prompt_caching );
+                ImGui::TextDisabled( "Follow-up questions reuse the function context from Anthropic's prompt cache" );
             }
 
             ImGui::Spacing( );
@@ -1143,14 +1287,36 @@ namespace ida_re::ui {
                 clear_cache( );
             }
             ImGui::SameLine( );
-            // Count total cached results across all files
-            size_t total_cached = 0;
-            for ( const auto &[ md5, file_cache ] : m_analysis_cache ) {
-                for ( const auto &[ addr, func_cache ] : file_cache ) {
-                    total_cached += func_cache.size( );
+            ImGui::TextDisabled( "(%zu cached results)", m_analysis_cache.size( ) );
+
+            if ( m_config ) {
+                ImGui::Text( "Analysis cache memory (MB):" );
+                ImGui::SetNextItemWidth( -1 );
+                if ( ImGui::InputInt( "##analysis_cache_mb", &m_config->m_analysis_cache_mb, 16, 128 ) ) {
+                    m_config->m_analysis_cache_mb = std::max( m_config->m_analysis_cache_mb, 0 );
                 }
+
+                ImGui::Text( "XRef preview memory (MB):" );
+                ImGui::SetNextItemWidth( -1 );
+                if ( ImGui::InputInt( "##xref_preview_cache_mb", &m_config->m_xref_preview_cache_mb ) ) {
+                    m_config->m_xref_preview_cache_mb = std::max( m_config->m_xref_preview_cache_mb, 0 );
+                }
+                ImGui::TextDisabled( "Least recently used entries leave memory first; results are reread from disk (0 = unlimited)" );
             }
-            ImGui::TextDisabled( "(%zu cached results)", total_cached );
+
+            const auto render_cache_stats = []( const char *label, const utils::lru_stats_t &stats ) {
+                ImGui::TextDisabled( "%s: %.1f MB in memory (%zu entries), %llu hits, %llu misses, %llu evicted", label,
+                                     static_cast< double >( stats.m_bytes + stats.m_pinned_bytes ) / ( 1024.0 * 1024.0 ), stats.m_entries,
+                                     static_cast< unsigned long long >( stats.m_hits ), static_cast< unsigned long long >( stats.m_misses ),
+                                     static_cast< unsigned long long >( stats.m_evictions ) );
+                if ( stats.m_pinned_bytes > 0 ) {
+                    ImGui::TextDisabled( "  of which %.1f MB changed since the last compaction, held in memory until the next one",
+                                         static_cast< double >( stats.m_pinned_bytes ) / ( 1024.0 * 1024.0 ) );
+                }
+            };
+            render_cache_stats( "Analysis cache", m_analysis_cache.stats( ) );
+            render_cache_stats( "Content cache", m_content_cache.stats( ) );
+            render_cache_stats( "XRef previews", m_xref_preview_cache.stats( ) );
 
             ImGui::Spacing( );
 
@@ -1181,6 +1347,17 @@ namespace ida_re::ui {
                     m_config->m_anthropic_base_url  = m_anthropic_base_url_buf;
                     m_config->m_mcp_host            = m_mcp_host_buf;
                     m_config->m_mcp_port            = m_mcp_port_buf;
+                    m_config->m_hedge_model         = m_hedge_model_buf;
+                    m_config->m_hedge_provider      = m_hedge_selected > 0
+                                                        ? std::string( api::to_string( static_cast< api::e_provider >( m_hedge_selected - 1 ) ) )
+                                                        : std::string( );
+
+                    apply_cache_limits( );
+
+                    if ( m_mcp ) {
+                        m_mcp->set_pool_size( static_cast< std::size_t >( m_config->m_mcp_pool_size ) );
+                        m_mcp->set_idle_timeout( std::chrono::seconds( m_config->m_mcp_idle_timeout ) );
+                    }
 
                     if ( m_selected_provider == 0 )
                         m_config->m_provider = "claude";
@@ -1342,105 +1519,260 @@ namespace ida_re::ui {
             m_llm->claude( ).set_api_key( m_config->m_claude_api_key );
             m_llm->claude( ).set_model( m_config->m_model );
             m_llm->claude( ).set_base_url( m_config->m_anthropic_base_url ); // Always set (empty = reset to default)
+            m_llm->claude( ).set_prompt_caching( m_config->m_claude_prompt_caching );
+            m_llm->claude( ).set_rate_limits( m_config->m_requests_per_minute, m_config->m_tokens_per_minute );
+            m_llm->claude( ).set_max_retries( m_config->m_max_retries );
         } else if ( m_config->m_provider == "openai" ) {
             provider = api::e_provider::openai;
             m_llm->openai( ).set_api_key( m_config->m_openai_api_key );
             m_llm->openai( ).set_model( m_config->m_model );
             m_llm->openai( ).set_base_url( m_config->m_openai_base_url ); // Always set (empty = reset to default)
+            m_llm->openai( ).set_rate_limits( m_config->m_requests_per_minute, m_config->m_tokens_per_minute );
+            m_llm->openai( ).set_max_retries( m_config->m_max_retries );
         } else if ( m_config->m_provider == "gemini" ) {
             provider = api::e_provider::gemini;
             m_llm->gemini( ).set_api_key( m_config->m_gemini_api_key );
             m_llm->gemini( ).set_model( m_config->m_model );
+            m_llm->gemini( ).set_rate_limits( m_config->m_requests_per_minute, m_config->m_tokens_per_minute );
+            m_llm->gemini( ).set_max_retries( m_config->m_max_retries );
         } else if ( m_config->m_provider == "openrouter" ) {
             provider = api::e_provider::openrouter;
             m_llm->openrouter( ).set_api_key( m_config->m_openrouter_api_key );
             m_llm->openrouter( ).set_model( m_config->m_model );
             m_llm->openrouter( ).set_show_free_only( m_config->m_openrouter_free_only );
+            m_llm->openrouter( ).set_rate_limits( m_config->m_requests_per_minute, m_config->m_tokens_per_minute );
+            m_llm->openrouter( ).set_max_retries( m_config->m_max_retries );
         }
 
         m_llm->set_provider( provider );
+        apply_hedge_to_llm( );
     }
 
-    void c_ui::save_cache( ) {
-        if ( !m_config || !m_config->m_enable_cache )
+    void c_ui::apply_hedge_to_llm( ) {
+        if ( !m_llm || !m_config )
             return;
 
-        try {
-            auto cache_path = core::app_config_t::get_cache_path( );
-            std::filesystem::create_directories( cache_path.parent_path( ) );
-
-            json_t j;
-            // Structure: { "file_md5": { "address": { "type": "result" } } }
-            for ( const auto &[ file_md5, file_cache ] : m_analysis_cache ) {
-                for ( const auto &[ addr, func_cache ] : file_cache ) {
-                    for ( const auto &[ type, result ] : func_cache ) {
-                        j[ file_md5 ][ addr ][ type ] = result;
-                    }
-                }
+        api::hedge_policy_t policy;
+        const auto          backup = api::provider_from_string( m_config->m_hedge_provider );
+
+        if ( backup && *backup != m_llm->get_provider( ) ) {
+            policy.m_enabled              = true;
+            policy.m_secondary            = *backup;
+            policy.m_first_token_deadline = std::chrono::milliseconds( std::max( m_config->m_hedge_delay_ms, 0 ) );
+
+            // the backup client uses the key saved for its provider; an empty model keeps the client's default
+            const auto &model = m_config->m_hedge_model;
+            switch ( *backup ) {
+                case api::e_provider::claude :
+                    m_llm->claude( ).set_api_key( m_config->m_claude_api_key );
+                    m_llm->claude( ).set_base_url( m_config->m_anthropic_base_url );
+                    if ( !model.empty( ) )
+                        m_llm->claude( ).set_model( model );
+                    break;
+                case api::e_provider::openai :
+                    m_llm->openai( ).set_api_key( m_config->m_openai_api_key );
+                    m_llm->openai( ).set_base_url( m_config->m_openai_base_url );
+                    if ( !model.empty( ) )
+                        m_llm->openai( ).set_model( model );
+                    break;
+                case api::e_provider::gemini :
+                    m_llm->gemini( ).set_api_key( m_config->m_gemini_api_key );
+                    if ( !model.empty( ) )
+                        m_llm->gemini( ).set_model( model );
+                    break;
+                case api::e_provider::openrouter :
+                    m_llm->openrouter( ).set_api_key( m_config->m_openrouter_api_key );
+                    if ( !model.empty( ) )
+                        m_llm->openrouter( ).set_model( model );
+                    break;
             }
-
-            std::ofstream f( cache_path );
-            f << j.dump( 2 );
-        } catch ( ... ) {
-            // Silently fail - cache is not critical
         }
+
+        m_llm->set_hedge_policy( policy );
     }
 
     void c_ui::load_cache( ) {
         if ( !m_config || !m_config->m_enable_cache )
             return;
 
-        try {
-            auto cache_path = core::app_config_t::get_cache_path( );
-            if ( !std::filesystem::exists( cache_path ) )
-                return;
+        // results are journaled as they arrive; failing to open only costs persistence, the cache still works in memory
+        [[maybe_unused]] const auto opened = m_analysis_cache.open( core::app_config_t::get_cache_path( ), core::app_config_t::get_legacy_cache_path( ) );
+        [[maybe_unused]] const auto content_opened = m_content_cache.open( core::app_config_t::get_content_cache_path( ) );
+        [[maybe_unused]] const auto index_opened   = m_similarity_index.open( core::app_config_t::get_similarity_index_path( ) );
+    }
 
-            std::ifstream f( cache_path );
-            json_t        j = json_t::parse( f );
+    void c_ui::apply_cache_limits( ) {
+        if ( !m_config )
+            return;
 
-            m_analysis_cache.clear( );
-            // Structure: { "file_md5": { "address": { "type": "result" } } }
-            for ( auto it_file = j.begin( ); it_file != j.end( ); ++it_file ) {
-                std::string file_md5 = it_file.key( );
-                for ( auto it_addr = it_file.value( ).begin( ); it_addr != it_file.value( ).end( ); ++it_addr ) {
-                    std::string addr = it_addr.key( );
-                    for ( auto it_type = it_addr.value( ).begin( ); it_type != it_addr.value( ).end( ); ++it_type ) {
-                        m_analysis_cache[ file_md5 ][ addr ][ it_type.key( ) ] = it_type.value( ).get< std::string >( );
-                    }
-                }
-            }
-        } catch ( ... ) {
-            // Silently fail - cache is not critical
-        }
+        constexpr std::size_t k_mb                = 1024 * 1024;
+        const auto            analysis_budget     = static_cast< std::size_t >( std::max( m_config->m_analysis_cache_mb, 0 ) ) * k_mb;
+        const auto            xref_preview_budget = static_cast< std::size_t >( std::max( m_config->m_xref_preview_cache_mb, 0 ) ) * k_mb;
+
+        m_analysis_cache.set_memory_budget( analysis_budget );
+        m_content_cache.set_memory_budget( analysis_budget );
+        m_xref_preview_cache.set_capacity( xref_preview_budget );
     }
 
     void c_ui::clear_cache( ) {
         m_analysis_cache.clear( );
+        m_content_cache.clear( );
+        m_similarity_index.clear( );
+        m_similar_functions.clear( );
+    }
 
-        try {
-            auto cache_path = core::app_config_t::get_cache_path( );
-            if ( std::filesystem::exists( cache_path ) ) {
-                std::filesystem::remove( cache_path );
+    void c_ui::load_function( std::string_view address ) {
+        if ( !m_mcp || !m_mcp->is_connected( ) )
+            return;
+
+        // Pseudocode, assembly and xrefs in a single round trip, off the UI thread
+        std::vector< api::mcp_tool_call_t > calls = {
+            { "get_function_pseudocode", { { "address", address } } },
+            {   "get_function_assembly", { { "address", address } } },
+            {      "get_function_xrefs", { { "address", address } } },
+        };
+
+        // a newer load supersedes any request still in flight
+        const auto generation = ++m_load_generation;
+        m_function_loading    = true;
+
+        m_mcp->call_tools_batch_async( std::move( calls ),
+                                       [ this, generation, addr = std::string( address ) ]( std::vector< api::mcp_tool_result_t > results ) {
+                                           if ( generation != m_load_generation )
+                                               return;
+
+                                           m_function_loading = false;
+                                           apply_loaded_function( addr, results );
+                                       } );
+    }
+
+    void c_ui::request_xref_preview( const std::string &address ) {
+        m_xref_preview_pending.insert( address );
+
+        m_mcp->call_tool_async( "get_function_pseudocode", { { "address", address } }, [ this, address ]( api::mcp_tool_result_t result ) {
+            m_xref_preview_pending.erase( address );
+
+            if ( result.m_success && result.m_data.contains( "pseudocode" ) ) {
+                std::string preview = result.m_data[ "pseudocode" ].get< std::string >( );
+                // Limit preview to first 5 lines
+                size_t count = 0;
+                size_t pos   = 0;
+                while ( count < 5 && ( pos = preview.find( '\n', pos ) ) != std::string::npos ) {
+                    pos++;
+                    count++;
+                }
+                if ( pos != std::string::npos ) {
+                    preview = preview.substr( 0, pos ) + "\n...";
+                }
+                const auto bytes = preview.capacity( );
+                m_xref_preview_cache.put( address, std::move( preview ), bytes );
+            } else {
+                m_xref_preview_cache.put( address, "Preview not available", 0 );
             }
-        } catch ( ... ) {
-            // Silently fail
+        } );
+    }
+
+    void c_ui::apply_connect_result( connect_result_t result ) {
+        m_connecting = false;
+
+        if ( !result.m_connected ) {
+            m_connection_error = result.m_error;
+            return;
         }
+
+        if ( result.m_db_info.m_success ) {
+            m_current_file_md5  = result.m_db_info.m_data.value( "md5", "Unknown" );
+            m_current_file_name = result.m_db_info.m_data.value( "input_file_name", "Unknown" );
+        } else {
+            m_current_file_md5  = "Unknown";
+            m_current_file_name = "Unknown";
+        }
+
+        refresh_function_list( );
     }
 
-    void c_ui::load_function( std::string_view address ) {
-        if ( !m_mcp || !m_mcp->is_connected( ) )
+    void c_ui::refresh_function_list( ) {
+        if ( !m_mcp )
             return;
 
-        // Get pseudocode
-        auto pseudo_result = m_mcp->get_function_pseudocode( address );
-        if ( !pseudo_result.m_success )
+        // pages land one per completion, so the navigator fills in while the rest is still being fetched
+        constexpr int k_function_page_size = 2000;
+
+        clear_function_list( );
+        m_function_total      = 0;
+        m_functions_streaming = true;
+
+        const auto generation = ++m_function_list_generation;
+        m_mcp->list_functions_paged( k_function_page_size, [ this, generation ]( api::mcp_function_page_t page ) {
+            if ( generation != m_function_list_generation )
+                return;
+
+            if ( page.m_offset == 0 ) {
+                m_function_list.reserve( page.m_total );
+                m_function_search_keys.reserve( page.m_total );
+            }
+
+            m_function_total = page.m_total;
+            for ( auto &function : page.m_functions ) {
+                m_function_search_keys.push_back( make_search_key( function ) );
+                m_function_list.push_back( std::move( function ) );
+            }
+
+            if ( page.m_done ) {
+                m_functions_streaming = false;
+                rebuild_fuzzy_index( );
+            }
+        } );
+    }
+
+    void c_ui::clear_function_list( ) {
+        m_function_list.clear( );
+        m_function_search_keys.clear( );
+        m_filtered_functions.clear( );
+        m_filtered_upto    = 0;
+        m_fuzzy_generation = 0;
+    }
+
+    void c_ui::rebuild_fuzzy_index( ) {
+        std::vector< utils::fuzzy_entry_t > entries;
+        entries.reserve( m_function_list.size( ) );
+        for ( const auto &[ addr, name, size ] : m_function_list ) {
+            entries.push_back( { name, addr, size } );
+        }
+
+        m_fuzzy_generation = m_fuzzy_search.set_entries( std::move( entries ) );
+    }
+
+    void c_ui::update_function_filter( ) {
+        // a changed filter rescans everything; otherwise only entries appended since the last frame are tested
+        if ( m_function_filter_dirty ) {
+            m_filtered_functions.clear( );
+            m_filtered_upto         = 0;
+            m_function_filter_dirty = false;
+        }
+
+        if ( m_filtered_upto == m_function_list.size( ) )
             return;
 
-        // Get assembly
-        auto asm_result = m_mcp->get_function_assembly( address );
+        std::string filter_lower = m_function_filter;
+        std::transform( filter_lower.begin( ), filter_lower.end( ), filter_lower.begin( ), ::tolower );
 
-        // Get xrefs
-        auto xrefs_result = m_mcp->get_function_xrefs( address );
+        for ( std::size_t i = m_filtered_upto; i < m_function_list.size( ); i++ ) {
+            if ( filter_lower.empty( ) || m_function_search_keys[ i ].find( filter_lower ) != std::string::npos ) {
+                m_filtered_functions.push_back( i );
+            }
+        }
+
+        m_filtered_upto = m_function_list.size( );
+    }
+
+    void c_ui::apply_loaded_function( std::string_view address, const std::vector< api::mcp_tool_result_t > &results ) {
+        const auto &pseudo_result = results[ 0 ];
+        if ( !pseudo_result.m_success )
+            return;
+
+        const auto &asm_result   = results[ 1 ];
+        const auto &xrefs_result = results[ 2 ];
 
         m_current_func.m_loaded     = true;
         m_current_func.m_address    = address;
@@ -1450,6 +1782,7 @@ namespace ida_re::ui {
         if ( asm_result.m_success ) {
             m_current_func.m_assembly = asm_result.m_data.value( "assembly", "" );
         }
+        ++m_code_version;
 
         m_current_func.m_xrefs_to.clear( );
         m_current_func.m_xrefs_from.clear( );
@@ -1471,6 +1804,7 @@ namespace ida_re::ui {
         }
 
         m_analysis_result.clear( );
+        find_similar_functions( );
 
         // Switch to Pseudocode tab to show the loaded function
         m_current_tab = 0;
@@ -1480,22 +1814,36 @@ namespace ida_re::ui {
         if ( !m_llm )
             return;
 
-        m_chat_history.push_back( { true, std::string( message ), std::chrono::system_clock::now( ) } );
+        // the conversation is copied here: message points into m_chat_input, which the caller clears
+        std::vector< api::message_t > conversation;
+        {
+            std::lock_guard< std::mutex > lock( m_chat_mutex );
+            m_chat_history.push_back( { true, std::string( message ), std::chrono::system_clock::now( ) } );
+            m_streaming_buffer.clear( );
+
+            for ( const auto &msg : m_chat_history ) {
+                if ( !msg.m_is_error ) {
+                    conversation.push_back( msg.m_is_user ? api::message_t::user( msg.m_content ) : api::message_t::assistant( msg.m_content ) );
+                }
+            }
+        }
         m_chat_loading = true;
-        m_streaming_buffer.clear( );
 
         if ( m_chat_thread.joinable( ) )
             m_chat_thread.join( );
 
-        m_chat_thread = std::thread( [ this, message ]( ) {
-            auto resp = m_llm->send( message );
+        m_chat_thread = std::thread( [ this, conversation = std::move( conversation ) ]( ) {
+            auto resp = m_llm->stream( conversation, [ this ]( std::string_view chunk ) {
+                std::lock_guard< std::mutex > lock( m_chat_mutex );
+                m_streaming_buffer.append( chunk );
+            } );
 
             {
                 std::lock_guard< std::mutex > lock( m_chat_mutex );
                 if ( resp.m_success ) {
                     m_chat_history.push_back( { false, resp.m_content, std::chrono::system_clock::now( ) } );
                 } else {
-                    m_chat_history.push_back( { false, "Error: " + resp.m_error, std::chrono::system_clock::now( ) } );
+                    m_chat_history.push_back( { false, "Error: " + resp.m_error, std::chrono::system_clock::now( ), true } );
                 }
                 m_streaming_buffer.clear( );
             }
@@ -1510,27 +1858,26 @@ namespace ida_re::ui {
 
         // Add user message to chat history
         m_analysis_chat_history.push_back( { true, std::string( message ), std::chrono::system_clock::now( ) } );
+
+        // the rolling cache breakpoint moves to the new last turn, so the next follow-up reads everything
+        // up to here from the prompt cache; the context turn keeps its own breakpoint
+        if ( m_analysis_messages.size( ) > 2 )
+            m_analysis_messages[ m_analysis_messages.size( ) - 2 ].m_cache = false;
+        m_analysis_messages.push_back( api::message_t::cached_user( message ) );
+
+        clear_analysis_stream( );
         m_analysis_loading = true;
 
         if ( m_analysis_thread.joinable( ) )
             m_analysis_thread.join( );
 
-        m_analysis_thread = std::thread( [ this, message ]( ) {
-            // Build context: include the analysis context + full chat history
-            std::string full_message = m_analysis_context;
-
-            // Add chat history
-            for ( const auto &msg : m_analysis_chat_history ) {
-                if ( msg.m_is_user ) {
-                    full_message += "\n\nUser: " + msg.m_content;
-                } else {
-                    full_message += "\n\nAssistant: " + msg.m_content;
-                }
-            }
-
-            auto resp = m_llm->send( full_message );
+        m_analysis_thread = std::thread( [ this ]( ) {
+            // m_analysis_messages is left alone by the UI thread while m_analysis_loading is set
+            auto resp = m_llm->stream( m_analysis_messages, analysis_stream_sink( ) );
+            set_analysis_usage( resp.m_usage );
 
             if ( resp.m_success ) {
+                m_analysis_messages.push_back( api::message_t::assistant( resp.m_content ) );
                 m_analysis_chat_history.push_back( { false, resp.m_content, std::chrono::system_clock::now( ) } );
                 m_analysis_result = resp.m_content;
 
@@ -1550,14 +1897,52 @@ namespace ida_re::ui {
                     m_history.add_entry( entry );
                 }
             } else {
-                m_analysis_chat_history.push_back( { false, "Error: " + resp.m_error, std::chrono::system_clock::now( ) } );
+                // drop the unanswered question so turns keep alternating
+                m_analysis_messages.pop_back( );
+                m_analysis_chat_history.push_back( { false, "Error: " + resp.m_error, std::chrono::system_clock::now( ), true } );
                 m_analysis_result = "Error: " + resp.m_error;
             }
 
+            clear_analysis_stream( );
             m_analysis_loading = false;
         } );
     }
 
+    api::stream_callback_t c_ui::analysis_stream_sink( ) {
+        return [ this ]( std::string_view chunk ) {
+            std::lock_guard< std::mutex > lock( m_chat_mutex );
+            m_analysis_streaming_buffer.append( chunk );
+        };
+    }
+
+    void c_ui::clear_analysis_stream( ) {
+        std::lock_guard< std::mutex > lock( m_chat_mutex );
+        m_analysis_streaming_buffer.clear( );
+    }
+
+    void c_ui::set_analysis_usage( const api::token_usage_t &usage ) {
+        std::lock_guard< std::mutex > lock( m_chat_mutex );
+        m_analysis_usage = usage;
+    }
+
+    void c_ui::begin_analysis_conversation( std::string_view context, std::string_view reply ) {
+        m_analysis_messages.clear( );
+        m_analysis_messages.push_back( api::message_t::cached_user( context ) );
+        m_analysis_messages.push_back( api::message_t::assistant( reply ) );
+    }
+
+    const std::string &c_ui::current_content_key( ) {
+        if ( const std::uint64_t version = m_code_version; version != m_content_key_version ) {
+            m_content_key         = utils::pseudocode_fingerprint( m_current_func.m_pseudocode );
+            m_content_key_version = version;
+        }
+        return m_content_key;
+    }
+
+    std::string c_ui::current_prompt_identity( ) const {
+        return m_llm ? utils::sha256_hex( m_llm->prompt_identity( ) ) : std::string( );
+    }
+
     void c_ui::perform_analysis( std::string_view type, bool force_new ) {
         if ( !m_llm || m_current_func.m_pseudocode.empty( ) )
             return;
@@ -1570,11 +1955,21 @@ namespace ida_re::ui {
         std::string code     = m_current_func.m_pseudocode;
         std::string file_md5 = m_current_file_md5;
 
+        // Results are looked up by what was asked, not where: the same code under the same model and prompts hits
+        // in any binary or IDB, and any edit to the code misses instead of returning a stale answer
+        const std::string   content_key = current_content_key( );
+        const std::string   identity    = current_prompt_identity( );
+        const std::uint64_t simhash     = utils::c_similarity_index::simhash( m_highlighter.code_tokens( code ) );
+
         // Check cache if not forcing new analysis
-        if ( !force_new && !file_md5.empty( ) && m_analysis_cache.find( file_md5 ) != m_analysis_cache.end( )
-             && m_analysis_cache[ file_md5 ].find( addr ) != m_analysis_cache[ file_md5 ].end( ) ) {
-            auto &func_cache = m_analysis_cache[ file_md5 ][ addr ];
-            if ( func_cache.find( type_str ) != func_cache.end( ) ) {
+        if ( !force_new ) {
+            if ( const auto cached = m_content_cache.find( content_key, identity, type_str ) ) {
+                // first seen in another binary: record it for this one too, for the function list and memory search
+                if ( !file_md5.empty( ) && m_analysis_cache.find( file_md5, addr, type_str ) != cached ) {
+                    m_analysis_cache.put( file_md5, addr, type_str, *cached );
+                    m_similarity_index.add( file_md5, addr, name, simhash );
+                }
+
                 // Use cached result
                 m_analysis_chat_history.clear( );
 
@@ -1590,51 +1985,59 @@ namespace ida_re::ui {
                                    + "\n\nPlease suggest a better name for this function.";
                 }
 
-                m_analysis_context = context_prompt;
-                m_analysis_chat_history.push_back( { false, func_cache[ type_str ], std::chrono::system_clock::now( ) } );
-                m_analysis_result = func_cache[ type_str ];
+                begin_analysis_conversation( context_prompt, *cached );
+                m_analysis_chat_history.push_back( { false, *cached, std::chrono::system_clock::now( ) } );
+                m_analysis_result = *cached;
                 return;
             }
         }
 
+        clear_analysis_stream( );
         m_analysis_loading = true;
         if ( m_analysis_thread.joinable( ) )
             m_analysis_thread.join( );
+        m_analysis_request = api::make_request( );
 
         static constexpr std::array provider_names = { "Claude", "OpenAI", "Gemini" };
         int                         provider_idx   = m_llm ? static_cast< int >( m_llm->get_provider( ) ) : 2;
         std::string                 provider       = provider_names[ provider_idx ];
+        const api::e_provider       primary        = m_llm->get_provider( );
 
-        m_analysis_thread = std::thread( [ this, addr, name, code, provider, type_str, file_md5 ]( ) {
+        m_analysis_thread = std::thread( [ this, addr, name, code, provider, primary, type_str, file_md5, content_key, identity, simhash,
+                                           request = m_analysis_request ]( ) {
             api::response_t resp;
             std::string     context_prompt;
 
             if ( type_str == "general" ) {
-                resp = m_llm->explain_function( code );
+                resp = m_llm->explain_function( code, analysis_stream_sink( ), request );
                 context_prompt
                     = "Analyzing function " + name + " at " + addr + ":\n\n" + code + "\n\nPlease explain what this function does.";
             } else if ( type_str == "vulnerability" ) {
-                resp           = m_llm->find_vulnerabilities( code );
+                resp           = m_llm->find_vulnerabilities( code, analysis_stream_sink( ), request );
                 context_prompt = "Finding vulnerabilities in function " + name + " at " + addr + ":\n\n" + code
                                + "\n\nPlease identify potential security vulnerabilities.";
             } else if ( type_str == "naming" ) {
-                resp           = m_llm->suggest_name( code );
+                resp           = m_llm->suggest_name( code, analysis_stream_sink( ), request );
                 context_prompt = "Suggesting name for function " + name + " at " + addr + ":\n\n" + code
                                + "\n\nPlease suggest a better name for this function.";
             }
 
             m_analysis_result = resp.m_success ? resp.m_content : ( "Error: " + resp.m_error );
+            set_analysis_usage( resp.m_usage );
 
             if ( resp.m_success ) {
-                // Cache the result
+                // Cache the result. identity names the primary model; an answer the hedge backup won is not stored
+                // under it, so switching models never serves another model's answer
+                if ( resp.m_provider == primary )
+                    m_content_cache.put( content_key, identity, type_str, resp.m_content );
                 if ( !file_md5.empty( ) ) {
-                    m_analysis_cache[ file_md5 ][ addr ][ type_str ] = resp.m_content;
-                    save_cache( );
+                    m_analysis_cache.put( file_md5, addr, type_str, resp.m_content );
+                    m_similarity_index.add( file_md5, addr, name, simhash );
                 }
 
                 // Clear previous chat and set context
                 m_analysis_chat_history.clear( );
-                m_analysis_context = context_prompt;
+                begin_analysis_conversation( context_prompt, resp.m_content );
                 m_analysis_chat_history.push_back( { false, resp.m_content, std::chrono::system_clock::now( ) } );
 
                 utils::analysis_entry_t entry;
@@ -1647,6 +2050,7 @@ namespace ida_re::ui {
                 m_history.add_entry( entry );
             }
 
+            clear_analysis_stream( );
             m_analysis_loading = false;
         } );
     }
@@ -1659,18 +2063,32 @@ namespace ida_re::ui {
         if ( !m_mcp || !m_mcp->is_connected( ) || m_current_func.m_address.empty( ) )
             return;
 
-        auto result = m_mcp->rename_function( m_current_func.m_address, new_name );
-        if ( result.m_success ) {
-            m_current_func.m_name = new_name;
-            // Refresh function list
-            if ( auto it = std::ranges::find_if( m_function_list,
-                                                 [ this ]( const auto &f ) {
-                                                     return f.first == m_current_func.m_address;
-                                                 } );
-                 it != m_function_list.end( ) ) {
-                it->second = new_name;
-            }
-        }
+        json_t args = {
+            {  "address", m_current_func.m_address },
+            { "new_name",                 new_name }
+        };
+
+        m_mcp->call_tool_async( "rename_function", std::move( args ),
+                                [ this, address = m_current_func.m_address, name = std::string( new_name ) ]( api::mcp_tool_result_t result ) {
+                                    if ( !result.m_success )
+                                        return;
+
+                                    if ( m_current_func.m_address == address )
+                                        m_current_func.m_name = name;
+
+                                    // Refresh function list
+                                    if ( auto it = std::ranges::find_if( m_function_list, [ & ]( const auto &f ) { return f.m_address == address; } );
+                                         it != m_function_list.end( ) ) {
+                                        const auto index = static_cast< std::size_t >( std::distance( m_function_list.begin( ), it ) );
+
+                                        it->m_name                      = name;
+                                        m_function_search_keys[ index ] = make_search_key( *it );
+                                        m_function_filter_dirty         = true;
+
+                                        if ( m_fuzzy_generation != 0 )
+                                            rebuild_fuzzy_index( );
+                                    }
+                                } );
     }
 
     void c_ui::add_comment_in_ida( std::string_view comment ) {
@@ -1683,7 +2101,14 @@ namespace ida_re::ui {
             final_comment = final_comment.substr( 0, 1000 ) + "\n\n[Comment truncated - see full analysis in tool]";
         }
 
-        m_mcp->add_comment( m_current_func.m_address, final_comment, true );
+        json_t args = {
+            {    "address", m_current_func.m_address },
+            {    "comment",            final_comment },
+            { "repeatable",                     true }
+        };
+
+        // fire and forget; IDA shows the comment once the call lands
+        m_mcp->call_tool_async( "add_comment", std::move( args ), []( api::mcp_tool_result_t ) { } );
     }
 
     void c_ui::render_bookmarks_window( ) {
@@ -1786,48 +2211,45 @@ namespace ida_re::ui {
         }
 
         // Search through all cached analyses
-        for ( const auto &[ file_md5, file_cache ] : m_analysis_cache ) {
-            for ( const auto &[ address, func_cache ] : file_cache ) {
-                for ( const auto &[ analysis_type, content ] : func_cache ) {
-                    std::string content_lower = content;
-                    std::transform( content_lower.begin( ), content_lower.end( ), content_lower.begin( ), ::tolower );
-
-                    // Calculate relevance score
-                    int      relevance = 0;
-                    size_t   pos       = 0;
-                    while ( ( pos = content_lower.find( query_lower, pos ) ) != std::string::npos ) {
-                        relevance++;
-                        pos += query_lower.length( );
-                    }
-
-                    if ( relevance > 0 ) {
-                        memory_search_result_t result;
-                        result.m_file_md5       = file_md5;
-                        result.m_address        = address;
-                        result.m_analysis_type  = analysis_type;
-                        result.m_content        = content;
-                        result.m_relevance      = relevance;
-
-                        // Try to find function name from MCP
-                        if ( m_mcp && !m_current_file_md5.empty( ) && file_md5 == m_current_file_md5 ) {
-                            // Same file - can get function name from MCP potentially
-                            result.m_function_name = address; // Fallback to address
-                        } else {
-                            result.m_function_name = address;
-                        }
-
-                        // Set file name if it's the current file
-                        if ( !m_current_file_name.empty( ) && file_md5 == m_current_file_md5 ) {
-                            result.m_file_name = m_current_file_name;
-                        } else {
-                            result.m_file_name = file_md5.substr( 0, 8 ) + "..."; // Show first 8 chars of MD5
-                        }
+        m_analysis_cache.for_each( [ & ]( std::string_view file_md5, std::string_view address, std::string_view analysis_type,
+                                          std::string_view content ) {
+            std::string content_lower( content );
+            std::transform( content_lower.begin( ), content_lower.end( ), content_lower.begin( ), ::tolower );
+
+            // Calculate relevance score
+            int      relevance = 0;
+            size_t   pos       = 0;
+            while ( ( pos = content_lower.find( query_lower, pos ) ) != std::string::npos ) {
+                relevance++;
+                pos += query_lower.length( );
+            }
+
+            if ( relevance > 0 ) {
+                memory_search_result_t result;
+                result.m_file_md5       = std::string( file_md5 );
+                result.m_address        = std::string( address );
+                result.m_analysis_type  = std::string( analysis_type );
+                result.m_content        = std::string( content );
+                result.m_relevance      = relevance;
+
+                // Try to find function name from MCP
+                if ( m_mcp && !m_current_file_md5.empty( ) && file_md5 == m_current_file_md5 ) {
+                    // Same file - can get function name from MCP potentially
+                    result.m_function_name = std::string( address ); // Fallback to address
+                } else {
+                    result.m_function_name = std::string( address );
+                }
 
-                        m_memory_search_results.push_back( result );
-                    }
+                // Set file name if it's the current file
+                if ( !m_current_file_name.empty( ) && file_md5 == m_current_file_md5 ) {
+                    result.m_file_name = m_current_file_name;
+                } else {
+                    result.m_file_name = std::string( file_md5.substr( 0, 8 ) ) + "..."; // Show first 8 chars of MD5
                 }
+
+                m_memory_search_results.push_back( result );
             }
-        }
+        } );
 
         // Sort by relevance (highest first)
         std::sort( m_memory_search_results.begin( ), m_memory_search_results.end( ),
@@ -1836,6 +2258,69 @@ namespace ida_re::ui {
         m_memory_searching = false;
     }
 
+    void c_ui::find_similar_functions( ) {
+        m_similar_functions.clear( );
+        if ( m_current_func.m_pseudocode.empty( ) || m_similarity_index.size( ) == 0 )
+            return;
+
+        const auto tokens  = m_highlighter.code_tokens( m_current_func.m_pseudocode );
+        const auto simhash = utils::c_similarity_index::simhash( tokens );
+        const auto matches = m_similarity_index.query( simhash, k_similar_candidates, m_current_file_md5, m_current_func.m_address );
+
+        // closest first, so the first k_similar_functions with a result are the closest ones with a result
+        for ( const auto &match : matches ) {
+            if ( m_similar_functions.size( ) == k_similar_functions )
+                break;
+
+            // the explanation is what saves a re-read; the other analyses stand in for functions that only have those
+            for ( const std::string_view type : { "general", "vulnerability", "naming" } ) {
+                if ( auto result = m_analysis_cache.find( match.m_function.m_file_md5, match.m_function.m_address, type ) ) {
+                    m_similar_functions.push_back( { match, std::string( type ), std::move( *result ) } );
+                    break;
+                }
+            }
+        }
+    }
+
+    void c_ui::render_similar_functions( ) {
+        if ( m_similar_functions.empty( ) )
+            return;
+
+        const std::string header = "Similar analyzed functions (" + std::to_string( m_similar_functions.size( ) ) + ")###similar_functions";
+        if ( !ImGui::CollapsingHeader( header.c_str( ) ) )
+            return;
+
+        for ( std::size_t i = 0; i < m_similar_functions.size( ); i++ ) {
+            const auto &similar    = m_similar_functions[ i ];
+            const auto &function   = similar.m_match.m_function;
+            const bool  same_file  = function.m_file_md5 == m_current_file_md5;
+            const int   similarity = 100 - similar.m_match.m_distance * 100 / 64;
+
+            const std::string label = function.m_name + " @ " + function.m_address + " - "
+                                    + ( same_file ? std::string( "this binary" ) : function.m_file_md5.substr( 0, 8 ) + "..." ) + " - "
+                                    + std::to_string( similarity ) + "% similar";
+
+            ImGui::PushID( static_cast< int >( i ) );
+            if ( ImGui::TreeNode( label.c_str( ) ) ) {
+                ImGui::TextDisabled( "Cached %s analysis", similar.m_analysis_type.c_str( ) );
+                m_highlighter.render_markdown( similar.m_result );
+
+                if ( same_file && ImGui::SmallButton( "Open" ) ) {
+                    strncpy( m_address_input, function.m_address.c_str( ), sizeof( m_address_input ) - 1 );
+                    m_address_input[ sizeof( m_address_input ) - 1 ] = '\0';
+                    load_function( function.m_address );
+                }
+                if ( same_file )
+                    ImGui::SameLine( );
+                if ( ImGui::SmallButton( "Copy" ) ) {
+                    ImGui::SetClipboardText( similar.m_result.c_str( ) );
+                }
+                ImGui::TreePop( );
+            }
+            ImGui::PopID( );
+        }
+    }
+
     void c_ui::render_memory_search_window( ) {
         ImGui::SetNextWindowSize( ImVec2( 900, 650 ), ImGuiCond_FirstUseEver );
         if ( ImGui::Begin( "Memory Search - Agent Knowledge Base", &m_show_memory_search ) ) {
@@ -2068,7 +2553,8 @@ namespace ida_re::ui {
         }
 
         m_last_analysis_type = "custom";
-        m_analysis_loading   = true;
+        clear_analysis_stream( );
+        m_analysis_loading = true;
         if ( m_analysis_thread.joinable( ) )
             m_analysis_thread.join( );
 
@@ -2076,11 +2562,12 @@ namespace ida_re::ui {
         std::string name = m_current_func.m_name;
 
         m_analysis_thread = std::thread( [ this, prompt, addr, name, prompt_name ]( ) {
-            auto resp = m_llm->send( prompt );
+            auto resp = m_llm->stream( prompt, analysis_stream_sink( ) );
+            set_analysis_usage( resp.m_usage );
 
             if ( resp.m_success ) {
                 m_analysis_chat_history.clear( );
-                m_analysis_context = prompt;
+                begin_analysis_conversation( prompt, resp.m_content );
                 chat_message_t msg;
                 msg.m_is_user   = false;
                 msg.m_content   = resp.m_content;
@@ -2097,6 +2584,7 @@ namespace ida_re::ui {
                 m_history.add_entry( entry );
             }
 
+            clear_analysis_stream( );
             m_analysis_loading = false;
         } );
     }
@@ -2631,34 +3119,45 @@ namespace ida_re::ui {
 
         // Store original pseudocode for diff
         m_diff_before = m_current_func.m_pseudocode;
+        ++m_code_version;
+
+        const std::string &address = m_current_func.m_address;
 
-        // Apply variable renames and type changes
+        // Collect variable renames and type changes; the plugin applies them in order, so a type change
+        // after a rename targets the new name
+        std::vector< api::mcp_tool_call_t > calls;
         for ( const auto &var : m_local_variables ) {
             if ( !var.m_selected )
                 continue;
 
             // Rename if name changed
             if ( std::string( var.m_new_name ) != var.m_name ) {
-                auto result = m_mcp->rename_local_variable( m_current_func.m_address, var.m_name, var.m_new_name );
-                if ( !result.m_success ) {
-                    // Log error but continue
-                }
+                calls.push_back( { "rename_local_variable",
+                                   {
+                                       {  "address",        address },
+                                       { "old_name",     var.m_name },
+                                       { "new_name", var.m_new_name } } } );
             }
 
             // Change type if changed
             if ( std::string( var.m_new_type ) != var.m_type ) {
-                auto result = m_mcp->set_variable_type( m_current_func.m_address, std::string( var.m_new_name ), var.m_new_type );
-                if ( !result.m_success ) {
-                    // Log error but continue
-                }
+                calls.push_back( { "set_variable_type",
+                                   {
+                                       {  "address",        address },
+                                       { "var_name", var.m_new_name },
+                                       { "type_str", var.m_new_type } } } );
             }
         }
 
-        // Fetch updated pseudocode for diff
+        // Fetch updated pseudocode for diff in the same batch
+        calls.push_back( { "get_function_pseudocode", { { "address", address } } } );
+
         m_loading_diff_after.store( true, std::memory_order_release );
 
-        std::thread( [ this ]( ) {
-            auto result = m_mcp->get_function_pseudocode( m_current_func.m_address );
+        std::thread( [ this, calls = std::move( calls ) ]( ) {
+            // Failed renames/type changes are skipped; the diff shows what actually applied
+            auto  results = m_mcp->call_tools_batch( calls );
+            auto &result  = results.back( );
 
             if ( result.m_success && result.m_data.contains( "pseudocode" ) ) {
                 std::lock_guard< std::mutex > lock( m_chat_mutex );
@@ -2666,6 +3165,7 @@ namespace ida_re::ui {
 
                 // Update current function pseudocode
                 m_current_func.m_pseudocode = m_diff_after;
+                ++m_code_version;
 
                 // Show diff viewer
                 m_show_diff_viewer = true;
@@ -2714,7 +3214,7 @@ namespace ida_re::ui {
         ImGui::Text( "Before" );
         ImGui::Separator( );
         ImGui::PushStyleColor( ImGuiCol_Text, ImVec4( 0.9f, 0.3f, 0.3f, 1.0f ) ); // Red for before
-        m_highlighter.render_text( m_diff_before );
+        m_highlighter.render_text( m_diff_before, true, m_code_version );
         ImGui::PopStyleColor( );
         ImGui::EndChild( );
 
@@ -2724,7 +3224,7 @@ namespace ida_re::ui {
         ImGui::Text( "After" );
         ImGui::Separator( );
         ImGui::PushStyleColor( ImGuiCol_Text, ImVec4( 0.3f, 0.9f, 0.3f, 1.0f ) ); // Green for after
-        m_highlighter.render_text( m_diff_after );
+        m_highlighter.render_text( m_diff_after, true, m_code_version );
         ImGui::PopStyleColor( );
         ImGui::EndChild( );
 
@@ -2738,6 +3238,7 @@ namespace ida_re::ui {
 
         // Store original for diff
         m_diff_before = m_current_func.m_pseudocode;
+        ++m_code_version;
 
         // Capture current function data for thread
         const std::string func_address    = m_current_func.m_address;
@@ -2869,7 +3370,10 @@ Return ONLY the JSON, nothing else.)";
             auto suggestions  = json_t::parse( json_str );
             log              += "[OK] JSON parsed successfully\n\n";
 
-            // Apply variable renames
+            // Queue every rename and comment, then the refreshed pseudocode, as one batch
+            std::vector< api::mcp_tool_call_t > calls;
+            std::vector< std::string >          call_labels;
+
             if ( suggestions.contains( "variable_renames" ) && suggestions[ "variable_renames" ].is_array( ) ) {
                 log += "[INFO] Applying " + std::to_string( suggestions[ "variable_renames" ].size( ) ) + " variable renames...\n";
                 for ( const auto &rename : suggestions[ "variable_renames" ] ) {
@@ -2877,50 +3381,51 @@ Return ONLY the JSON, nothing else.)";
                         std::string old_name = rename[ "old_name" ].get< std::string >( );
                         std::string new_name = rename[ "new_name" ].get< std::string >( );
 
-                        log += "  - Renaming '" + old_name + "' -> '" + new_name + "'... ";
-
-                        auto result = m_mcp->rename_local_variable( func_address, old_name, new_name );
-
-                        if ( result.m_success ) {
-                            log += "OK\n";
-                        } else {
-                            log += "FAILED: " + result.m_error + "\n";
-                        }
-
-                        std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+                        call_labels.push_back( "  - Renaming '" + old_name + "' -> '" + new_name + "'... " );
+                        calls.push_back( { "rename_local_variable",
+                                           {
+                                               {  "address", func_address },
+                                               { "old_name",     old_name },
+                                               { "new_name",     new_name } } } );
                     }
                 }
             } else {
                 log += "[INFO] No variable renames suggested\n";
             }
 
-            // Apply comments
             if ( suggestions.contains( "comments" ) && suggestions[ "comments" ].is_array( ) ) {
                 log += "[INFO] Applying " + std::to_string( suggestions[ "comments" ].size( ) ) + " comments...\n";
                 for ( const auto &comment : suggestions[ "comments" ] ) {
                     if ( comment.contains( "text" ) ) {
-                        std::string          text = comment[ "text" ].get< std::string >( );
-                        std::optional< int > line_num;
+                        std::string text = comment[ "text" ].get< std::string >( );
 
+                        json_t args = {
+                            { "address", func_address },
+                            { "comment",         text }
+                        };
                         if ( comment.contains( "line" ) && comment[ "line" ].is_number( ) ) {
-                            line_num = comment[ "line" ].get< int >( );
+                            args[ "line_number" ] = comment[ "line" ].get< int >( );
                         }
 
-                        log += "  - Adding comment: " + text.substr( 0, 50 ) + "...\n";
-                        m_mcp->add_function_comment( func_address, text, line_num );
-
-                        std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+                        call_labels.push_back( "  - Adding comment: " + text.substr( 0, 50 ) + "... " );
+                        calls.push_back( { "add_function_comment", std::move( args ) } );
                     }
                 }
             }
 
-            // Wait for IDA to process
-            std::this_thread::sleep_for( std::chrono::milliseconds( 300 ) );
+            calls.push_back( { "get_function_pseudocode", { { "address", func_address } } } );
 
             // Fetch updated pseudocode for diff
             m_loading_diff_after.store( true, std::memory_order_release );
 
-            auto result = m_mcp->get_function_pseudocode( func_address );
+            auto results = m_mcp->call_tools_batch( calls );
+
+            for ( size_t i = 0; i < call_labels.size( ); ++i ) {
+                log += call_labels[ i ];
+                log += results[ i ].m_success ? "OK\n" : "FAILED: " + results[ i ].m_error + "\n";
+            }
+
+            const auto &result = results.back( );
 
             if ( result.m_success && result.m_data.contains( "pseudocode" ) ) {
                 std::lock_guard< std::mutex > lock( m_chat_mutex );
@@ -2928,6 +3433,7 @@ Return ONLY the JSON, nothing else.)";
 
                 // Update current function pseudocode
                 m_current_func.m_pseudocode = m_diff_after;
+                ++m_code_version;
 
                 // Show diff viewer
                 m_show_diff_viewer  = true;
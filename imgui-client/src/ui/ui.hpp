@@ -4,7 +4,12 @@
 #include "../api/mcp_client.hpp"
 #include "../core/config.hpp"
 #include "../core/installer.hpp"
+#include "../utils/analysis_cache.hpp"
 #include "../utils/analysis_history.hpp"
+#include "../utils/code_fingerprint.hpp"
+#include "../utils/fuzzy_search.hpp"
+#include "../utils/lru_cache.hpp"
+#include "../utils/similarity_index.hpp"
 #include "../utils/syntax_highlighter.hpp"
 
 #include <imgui.h>
@@ -14,6 +19,7 @@ namespace ida_re::ui {
         bool                                  m_is_user { };
         std::string                           m_content { };
         std::chrono::system_clock::time_point m_timestamp { };
+        bool                                  m_is_error { false }; // not replayed to the model as conversation
     };
 
     struct function_data_t {
@@ -26,6 +32,13 @@ namespace ida_re::ui {
         bool                       m_loaded { false };
     };
 
+    // gathered on a worker thread when the Connect button is pressed
+    struct connect_result_t {
+        bool                   m_connected { false };
+        std::string            m_error { };
+        api::mcp_tool_result_t m_db_info { };
+    };
+
     struct bookmark_t {
         std::string                           m_address { };
         std::string                           m_name { };
@@ -90,14 +103,28 @@ namespace ida_re::ui {
         void        apply_dark_theme( );
         void        apply_light_theme( );
         void        load_function( std::string_view address );
+        void        apply_loaded_function( std::string_view address, const std::vector< api::mcp_tool_result_t > &results );
+        void        apply_connect_result( connect_result_t result );
+        void        request_xref_preview( const std::string &address );
+        void        refresh_function_list( );
+        void        clear_function_list( );
+        void        update_function_filter( );
+        void        rebuild_fuzzy_index( );
         void        send_chat_message( std::string_view message );
         void        send_analysis_chat_message( std::string_view message );
+        void        clear_analysis_stream( );
+        void        set_analysis_usage( const api::token_usage_t &usage );
+        void        begin_analysis_conversation( std::string_view context, std::string_view reply );
         void        analyze_current_function( );
         void        perform_analysis( std::string_view type, bool force_new = false );
+        // m_content_cache keys of the loaded function: fingerprint of its pseudocode, hash of the prompt identity
+        [[nodiscard]] const std::string &current_content_key( );
+        [[nodiscard]] std::string        current_prompt_identity( ) const;
         void        perform_custom_analysis( std::string_view prompt_name );
         void        apply_config_to_llm( );
-        void        save_cache( );
+        void        apply_hedge_to_llm( );
         void        load_cache( );
+        void        apply_cache_limits( );
         void        clear_cache( );
         void        save_bookmarks( );
         void        load_bookmarks( );
@@ -112,6 +139,8 @@ namespace ida_re::ui {
         void        render_plugin_installer_window( );
         void        render_memory_search_window( );
         void        search_analysis_memory( );
+        void        find_similar_functions( );
+        void        render_similar_functions( );
         void        export_history_markdown( std::string_view path );
         void        export_history_html( std::string_view path );
         void        rename_function_in_ida( std::string_view new_name );
@@ -121,6 +150,9 @@ namespace ida_re::ui {
         void        ai_improve_pseudocode( );
         std::string parse_and_apply_ai_suggestions( std::string_view ai_response, std::string_view func_address );
 
+        // stream callback appending to m_analysis_streaming_buffer, for analysis worker threads
+        api::stream_callback_t analysis_stream_sink( );
+
         api::c_mcp_client       *m_mcp { nullptr };
         api::c_llm_manager      *m_llm { nullptr };
         core::app_config_t      *m_config { nullptr };
@@ -133,12 +165,35 @@ namespace ida_re::ui {
         char                                                 m_address_input[ 64 ] { "0x" };
         char                                                 m_function_filter[ 256 ] { };
         function_data_t                                      m_current_func { };
-        std::vector< std::pair< std::string, std::string > > m_function_list { };
+        std::atomic< std::uint64_t >                         m_code_version { 1 }; // bumped when the code or a diff pane changes
+        std::vector< api::mcp_function_t >                   m_function_list { };
+
+        // function navigator filter state: one lowercase "address\nname" key per m_function_list entry,
+        // and the indices that match the current filter (rebuilt only when the filter text changes)
+        std::vector< std::string > m_function_search_keys { };
+        std::vector< std::size_t > m_filtered_functions { };
+        std::size_t                m_filtered_upto { 0 };
+        bool                       m_function_filter_dirty { true };
+
+        // ranked fuzzy matches replace the substring filter once the full list is indexed;
+        // m_fuzzy_generation is 0 while there is no index for the current list
+        utils::c_fuzzy_search m_fuzzy_search { };
+        std::uint64_t         m_fuzzy_generation { 0 };
+
+        // async MCP state; only touched on the UI thread (completions run from poll_completions)
+        bool                              m_connecting { false };
+        std::string                       m_connection_error { };
+        bool                              m_function_loading { false };
+        std::uint64_t                     m_load_generation { 0 };
+        std::unordered_set< std::string > m_xref_preview_pending { };
+        std::uint64_t                     m_function_list_generation { 0 };
+        std::size_t                       m_function_total { 0 };
+        bool                              m_functions_streaming { false };
 
         // chat
         std::deque< chat_message_t > m_chat_history { };
         char                         m_chat_input[ 4096 ] { };
-        std::string                  m_streaming_buffer { };
+        std::string                  m_streaming_buffer { }; // guarded by m_chat_mutex
         std::atomic< bool >          m_chat_loading { false };
         std::mutex                   m_chat_mutex { };
         std::thread                  m_chat_thread { };
@@ -146,10 +201,14 @@ namespace ida_re::ui {
         // analysis
         std::string                  m_analysis_result { };
         std::atomic< bool >          m_analysis_loading { false };
+        std::string                  m_analysis_streaming_buffer { }; // guarded by m_chat_mutex
+        api::token_usage_t           m_analysis_usage { };            // last analysis reply, guarded by m_chat_mutex
         std::thread                  m_analysis_thread { };
+        api::request_handle_t        m_analysis_request { }; // the running analysis; cancelled on shutdown
         std::deque< chat_message_t > m_analysis_chat_history { };
         char                         m_analysis_chat_input[ 4096 ] { };
-        std::string                  m_analysis_context { }; // stores the initial analysis context
+        // the conversation sent to the model: the function context, then alternating turns; follow-ups only append
+        std::vector< api::message_t > m_analysis_messages { };
 
         // windows
         bool m_show_settings { false };
@@ -170,19 +229,38 @@ namespace ida_re::ui {
         char m_anthropic_base_url_buf[ 256 ] { };
         char m_mcp_host_buf[ 64 ] { "127.0.0.1" };
         int  m_mcp_port_buf { 13120 };
+        int  m_hedge_selected { 0 }; // 0=Off, then providers in e_provider order
+        char m_hedge_model_buf[ 128 ] { };
         bool m_settings_initialized { false };
 
         // history state
         int m_selected_history_entry { -1 };
 
         // xref preview cache
-        std::unordered_map< std::string, std::string > m_xref_preview_cache { };
+        utils::c_lru_cache< std::string, std::string > m_xref_preview_cache { };
 
         // analysis results cache: file_md5 -> {address -> {type -> result}}
-        std::unordered_map< std::string, std::unordered_map< std::string, std::unordered_map< std::string, std::string > > >
-                    m_analysis_cache { };
-        std::string m_current_file_md5 { };
-        std::string m_current_file_name { };
+        utils::c_analysis_cache m_analysis_cache { };
+        // the same results by content: pseudocode fingerprint -> {prompt identity hash -> {type -> result}}.
+        // This is the one analyses are served from; m_analysis_cache records what each binary has had analyzed
+        utils::c_analysis_cache m_content_cache { };
+        std::string             m_content_key { };           // current_content_key( ), rehashed when m_code_version moves
+        std::uint64_t           m_content_key_version { 0 };
+
+        // near-duplicates of the loaded function among everything analyzed before, with a cached result each
+        struct similar_function_view_t {
+            utils::similarity_match_t m_match { };
+            std::string               m_analysis_type { };
+            std::string               m_result { };
+        };
+
+        static constexpr std::size_t k_similar_functions  = 5;
+        static constexpr std::size_t k_similar_candidates = 50; // matches asked of the index; most may have no cached result
+
+        utils::c_similarity_index              m_similarity_index { };
+        std::vector< similar_function_view_t > m_similar_functions { };
+        std::string             m_current_file_md5 { };
+        std::string             m_current_file_name { };
 
         // cache popup state
         bool        m_show_cache_popup { false };
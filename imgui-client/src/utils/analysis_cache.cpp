@@ -0,0 +1,736 @@
+#include "vendor.hpp"
+#include "analysis_cache.hpp"
+
+#ifdef IDA_RE_PLATFORM_WINDOWS
+    #include <io.h>
+#else
+    #include <fcntl.h>
+#endif
+
+namespace ida_re::utils {
+    namespace {
+        // Snapshot layout, native (little-endian) byte order:
+        //   header     magic "IDARECA1", u32 version, u32 binary count
+        //   directory  per binary: u32 md5 length, u32 record count, u64 records offset, u64 records size, md5
+        //   records    per result: u32 address length, u32 type length, u32 result length, address, type, result
+        constexpr std::array< char, 8 > k_magic { 'I', 'D', 'A', 'R', 'E', 'C', 'A', '1' };
+        constexpr std::uint32_t         k_version          = 1;
+        constexpr std::size_t           k_header_size      = k_magic.size( ) + 2 * sizeof( std::uint32_t );
+        constexpr std::size_t           k_directory_header = 2 * sizeof( std::uint32_t ) + 2 * sizeof( std::uint64_t );
+        constexpr std::size_t           k_record_header    = 3 * sizeof( std::uint32_t );
+
+        // records are encoded into a buffer this large before it is written out
+        constexpr std::size_t k_write_buffer = 1 << 20;
+
+        // bounds-checked cursor over mapped bytes; a failed read leaves the output untouched
+        struct reader_t {
+            std::span< const std::byte > m_data { };
+            std::size_t                  m_pos { 0 };
+
+            template < typename T >
+            bool read( T &value ) noexcept {
+                if ( m_data.size( ) - m_pos < sizeof( T ) )
+                    return false;
+
+                std::memcpy( &value, m_data.data( ) + m_pos, sizeof( T ) );
+                m_pos += sizeof( T );
+                return true;
+            }
+
+            bool read_bytes( std::size_t length, std::string_view &out ) noexcept {
+                if ( m_data.size( ) - m_pos < length )
+                    return false;
+
+                out    = std::string_view( reinterpret_cast< const char * >( m_data.data( ) + m_pos ), length );
+                m_pos += length;
+                return true;
+            }
+        };
+
+        template < typename T >
+        void write( std::string &out, T value ) {
+            out.append( reinterpret_cast< const char * >( &value ), sizeof( T ) );
+        }
+
+        void write_record( std::string &out, std::string_view address, std::string_view type, std::string_view result ) {
+            write( out, static_cast< std::uint32_t >( address.size( ) ) );
+            write( out, static_cast< std::uint32_t >( type.size( ) ) );
+            write( out, static_cast< std::uint32_t >( result.size( ) ) );
+            out.append( address ).append( type ).append( result );
+        }
+
+        // Calls fn( address, type, result ) for up to count records in block; false if the block is truncated
+        template < typename fn_t >
+        bool visit_records( std::span< const std::byte > block, std::uint32_t count, fn_t &&fn ) {
+            reader_t reader { block };
+            for ( std::uint32_t i = 0; i < count; i++ ) {
+                std::uint32_t    address_length = 0, type_length = 0, result_length = 0;
+                std::string_view address, type, result;
+
+                if ( !reader.read( address_length ) || !reader.read( type_length ) || !reader.read( result_length )
+                     || !reader.read_bytes( address_length, address ) || !reader.read_bytes( type_length, type )
+                     || !reader.read_bytes( result_length, result ) )
+                    return false;
+
+                fn( address, type, result );
+            }
+            return true;
+        }
+
+        // flushes stdio buffers and the OS cache, so the bytes survive a crash or power loss
+        bool sync( std::FILE *file ) {
+            if ( std::fflush( file ) != 0 )
+                return false;
+#ifdef IDA_RE_PLATFORM_WINDOWS
+            return _commit( _fileno( file ) ) == 0;
+#else
+            return ::fsync( fileno( file ) ) == 0;
+#endif
+        }
+
+        // makes a rename inside dir durable; NTFS journals renames itself
+        void sync_directory( [[maybe_unused]] const std::filesystem::path &dir ) {
+#ifndef IDA_RE_PLATFORM_WINDOWS
+            if ( const int fd = ::open( dir.c_str( ), O_RDONLY ); fd >= 0 ) {
+                ::fsync( fd );
+                ::close( fd );
+            }
+#endif
+        }
+
+        // one binary's records, parsed into address -> type -> result
+        template < typename functions_t >
+        functions_t parse_block( std::span< const std::byte > block, std::uint32_t count ) {
+            functions_t functions;
+            visit_records( block, count, [ & ]( std::string_view address, std::string_view type, std::string_view result ) {
+                functions[ std::string( address ) ].insert_or_assign( std::string( type ), std::string( result ) );
+            } );
+            return functions;
+        }
+
+        // heap bytes of one result: its hash node plus the strings' buffers
+        std::size_t footprint( const std::string &type, const std::string &result ) {
+            constexpr std::size_t k_node = 4 * sizeof( void * );
+            return k_node + sizeof( type ) + type.capacity( ) + sizeof( result ) + result.capacity( );
+        }
+
+        // heap bytes of one function's results, its own hash node included
+        template < typename results_t >
+        std::size_t footprint( const std::string &address, const results_t &results ) {
+            constexpr std::size_t k_node = 4 * sizeof( void * );
+
+            std::size_t bytes = k_node + sizeof( address ) + address.capacity( ) + sizeof( results );
+            for ( const auto &[ type, result ] : results ) {
+                bytes += footprint( type, result );
+            }
+            return bytes;
+        }
+
+        // heap bytes of one binary's results
+        template < typename functions_t >
+        std::size_t footprint( const functions_t &functions ) {
+            std::size_t bytes = 0;
+            for ( const auto &[ address, results ] : functions ) {
+                bytes += footprint( address, results );
+            }
+            return bytes;
+        }
+
+        std::string dump_line( const json_t &record ) {
+            auto line = record.dump( -1, ' ', false, json_t::error_handler_t::replace );
+            line.push_back( '\n' );
+            return line;
+        }
+
+        // Applies every complete line of a journal file through apply( record ); true if the file ends in a torn line
+        template < typename apply_fn_t >
+        bool replay_journal( const std::filesystem::path &path, apply_fn_t &&apply ) {
+            std::ifstream     journal( path, std::ios::binary );
+            const std::string contents { std::istreambuf_iterator< char >( journal ), std::istreambuf_iterator< char >( ) };
+
+            bool torn = false;
+            for ( std::size_t pos = 0; pos < contents.size( ); ) {
+                const auto newline  = contents.find( '\n', pos );
+                const auto line_end = newline == std::string::npos ? contents.size( ) : newline;
+                const auto line     = std::string_view( contents ).substr( pos, line_end - pos );
+                pos                 = line_end + 1;
+
+                if ( line.empty( ) )
+                    continue;
+
+                try {
+                    apply( json_t::parse( line ) );
+                } catch ( ... ) {
+                    torn = true;
+                }
+            }
+
+            // a last line without its newline was cut short by a crash, even if it happens to parse
+            return torn || ( !contents.empty( ) && contents.back( ) != '\n' );
+        }
+    } // namespace
+
+    c_analysis_cache::~c_analysis_cache( ) {
+        close( );
+        join_compactor( );
+    }
+
+    bool c_analysis_cache::open( const std::filesystem::path &path, const std::filesystem::path &legacy_path ) {
+        join_compactor( );
+
+        const std::lock_guard< std::mutex > journal_lk( m_journal_mutex );
+
+        if ( m_journal ) {
+            std::fclose( m_journal );
+            m_journal = nullptr;
+        }
+
+        m_path            = path;
+        m_journal_path    = path;
+        m_journal_path   += ".journal";
+        m_legacy_path     = legacy_path;
+        m_journal_records = 0;
+
+        bool torn     = false;
+        bool imported = false;
+        {
+            const std::lock_guard< std::mutex > lk( m_mutex );
+            m_dirty.clear( );
+            m_dirty_bytes = 0;
+            m_retry_bytes = 0;
+            m_loaded.clear( );
+            map_snapshot( );
+
+            std::error_code ec;
+            if ( m_snapshot.empty( ) && !m_legacy_path.empty( ) && std::filesystem::exists( m_legacy_path, ec ) ) {
+                try {
+                    std::ifstream f( m_legacy_path, std::ios::binary );
+                    const auto    j = json_t::parse( f );
+
+                    for ( const auto &[ file_md5, functions ] : j.items( ) ) {
+                        for ( const auto &[ address, results ] : functions.items( ) ) {
+                            for ( const auto &[ type, result ] : results.items( ) ) {
+                                auto &slot  = m_dirty[ file_md5 ][ address ];
+                                m_size     += slot.insert_or_assign( type, result.get< std::string >( ) ).second ? 1 : 0;
+                            }
+                        }
+                    }
+                } catch ( ... ) {
+                    // an unreadable legacy cache is left alone; its journal may still hold results
+                }
+
+                for ( const auto &[ file_md5, functions ] : m_dirty ) {
+                    m_dirty_bytes += footprint( functions );
+                }
+                fit_budget( );
+
+                auto legacy_journal  = m_legacy_path;
+                legacy_journal      += ".journal";
+                replay_journal( legacy_journal, [ & ]( const json_t &record ) { apply( record ); } );
+                imported = true;
+            }
+
+            torn = replay_journal( m_journal_path, [ & ]( const json_t &record ) {
+                apply( record );
+                m_journal_records++;
+            } );
+        }
+
+        std::error_code ec;
+        std::filesystem::create_directories( m_path.parent_path( ), ec );
+
+        // appending after a torn line would corrupt the next record too; start from a clean snapshot
+        if ( torn || imported )
+            return compact_locked( );
+
+        IDA_RE_FOPEN( m_journal, m_journal_path.string( ).c_str( ), "ab" );
+        return m_journal != nullptr;
+    }
+
+    void c_analysis_cache::close( ) {
+        join_compactor( );
+
+        const std::lock_guard< std::mutex > journal_lk( m_journal_mutex );
+        if ( !m_journal )
+            return;
+
+        if ( m_journal_records >= k_compact_records )
+            compact_locked( );
+
+        if ( m_journal ) {
+            std::fclose( m_journal );
+            m_journal = nullptr;
+        }
+    }
+
+    std::optional< std::string > c_analysis_cache::find( std::string_view file_md5, std::string_view address, std::string_view type ) {
+        const std::lock_guard< std::mutex > lk( m_mutex );
+
+        const auto *functions = lookup( std::string( file_md5 ) );
+        if ( !functions )
+            return std::nullopt;
+
+        const auto function = functions->find( std::string( address ) );
+        if ( function == functions->end( ) )
+            return std::nullopt;
+
+        const auto result = function->second.find( std::string( type ) );
+        if ( result == function->second.end( ) )
+            return std::nullopt;
+
+        return result->second;
+    }
+
+    bool c_analysis_cache::contains( std::string_view file_md5, std::string_view address, std::string_view type ) const {
+        const std::lock_guard< std::mutex > lk( m_mutex );
+
+        const std::string  key( file_md5 );
+        const functions_t *functions = nullptr;
+        if ( const auto dirty = m_dirty.find( key ); dirty != m_dirty.end( ) )
+            functions = &dirty->second;
+        else
+            functions = m_loaded.peek( key );
+
+        if ( functions ) {
+            const auto function = functions->find( std::string( address ) );
+            return function != functions->end( ) && function->second.contains( std::string( type ) );
+        }
+
+        const auto block = m_blocks.find( key );
+        if ( block == m_blocks.end( ) )
+            return false;
+
+        bool found = false;
+        visit_records( m_snapshot.data( ).subspan( block->second.m_offset, block->second.m_size ), block->second.m_count,
+                       [ & ]( std::string_view record_address, std::string_view record_type, std::string_view ) {
+                           found = found || ( record_address == address && record_type == type );
+                       } );
+        return found;
+    }
+
+    void c_analysis_cache::put( std::string_view file_md5, std::string_view address, std::string_view type, std::string_view result ) {
+        const json_t record = {
+            {     "op",    "put" },
+            {    "md5", file_md5 },
+            {   "addr",  address },
+            {   "type",     type },
+            { "result",   result }
+        };
+
+        const std::lock_guard< std::mutex > journal_lk( m_journal_mutex );
+        {
+            const std::lock_guard< std::mutex > lk( m_mutex );
+            apply( record );
+        }
+        if ( append( record ) )
+            compact_if_pinned( );
+    }
+
+    void c_analysis_cache::erase( std::string_view file_md5, std::string_view address ) {
+        const json_t record = {
+            {   "op",  "erase" },
+            {  "md5", file_md5 },
+            { "addr",  address }
+        };
+
+        const std::lock_guard< std::mutex > journal_lk( m_journal_mutex );
+        {
+            const std::lock_guard< std::mutex > lk( m_mutex );
+            apply( record );
+        }
+        if ( append( record ) )
+            compact_if_pinned( );
+    }
+
+    void c_analysis_cache::clear( ) {
+        const std::lock_guard< std::mutex > journal_lk( m_journal_mutex );
+        {
+            const std::lock_guard< std::mutex > lk( m_mutex );
+            m_dirty.clear( );
+            m_loaded.clear( );
+            m_blocks.clear( );
+            m_snapshot.close( );
+            m_size        = 0;
+            m_dirty_bytes = 0;
+            m_retry_bytes = 0;
+            fit_budget( );
+        }
+
+        if ( m_path.empty( ) )
+            return;
+
+        const bool reopen = m_journal != nullptr;
+        if ( m_journal ) {
+            std::fclose( m_journal );
+            m_journal = nullptr;
+        }
+
+        std::error_code ec;
+        std::filesystem::remove( m_path, ec );
+        std::filesystem::remove( m_journal_path, ec );
+        if ( !m_legacy_path.empty( ) ) {
+            auto legacy_journal  = m_legacy_path;
+            legacy_journal      += ".journal";
+            std::filesystem::remove( m_legacy_path, ec );
+            std::filesystem::remove( legacy_journal, ec );
+        }
+        m_journal_records = 0;
+
+        if ( reopen )
+            IDA_RE_FOPEN( m_journal, m_journal_path.string( ).c_str( ), "ab" );
+    }
+
+    bool c_analysis_cache::compact( ) {
+        const std::lock_guard< std::mutex > journal_lk( m_journal_mutex );
+        return compact_locked( );
+    }
+
+    std::size_t c_analysis_cache::size( ) const {
+        const std::lock_guard< std::mutex > lk( m_mutex );
+        return m_size;
+    }
+
+    void c_analysis_cache::set_memory_budget( std::size_t bytes ) {
+        const std::lock_guard< std::mutex > lk( m_mutex );
+        m_budget = bytes;
+        fit_budget( );
+    }
+
+    lru_stats_t c_analysis_cache::stats( ) const {
+        const std::lock_guard< std::mutex > lk( m_mutex );
+        auto stats           = m_loaded.stats( );
+        stats.m_pinned_bytes = m_dirty_bytes;
+        stats.m_capacity     = m_budget;
+        return stats;
+    }
+
+    void c_analysis_cache::for_each( const std::function< void( std::string_view, std::string_view, std::string_view,
+                                                                std::string_view ) > &fn ) const {
+        const std::lock_guard< std::mutex > lk( m_mutex );
+        for ( const auto &[ file_md5, functions ] : m_dirty ) {
+            for ( const auto &[ address, results ] : functions ) {
+                for ( const auto &[ type, result ] : results ) {
+                    fn( file_md5, address, type, result );
+                }
+            }
+        }
+
+        for ( const auto &[ file_md5, block ] : m_blocks ) {
+            if ( m_dirty.contains( file_md5 ) )
+                continue;
+
+            visit_records( m_snapshot.data( ).subspan( block.m_offset, block.m_size ), block.m_count,
+                           [ & ]( std::string_view address, std::string_view type, std::string_view result ) {
+                               fn( file_md5, address, type, result );
+                           } );
+        }
+    }
+
+    const c_analysis_cache::functions_t *c_analysis_cache::lookup( const std::string &file_md5 ) {
+        if ( const auto dirty = m_dirty.find( file_md5 ); dirty != m_dirty.end( ) )
+            return &dirty->second;
+
+        if ( const auto *loaded = m_loaded.find( file_md5 ) )
+            return loaded;
+
+        const auto block = m_blocks.find( file_md5 );
+        if ( block == m_blocks.end( ) )
+            return nullptr;
+
+        // a miss in memory is served from the mapping; only the mapped pages of this binary are touched
+        auto functions = parse_block< functions_t >( m_snapshot.data( ).subspan( block->second.m_offset, block->second.m_size ),
+                                                     block->second.m_count );
+        const auto bytes = footprint( functions );
+        return &m_loaded.put( file_md5, std::move( functions ), bytes );
+    }
+
+    c_analysis_cache::functions_t &c_analysis_cache::modify( const std::string &file_md5 ) {
+        if ( const auto dirty = m_dirty.find( file_md5 ); dirty != m_dirty.end( ) )
+            return dirty->second;
+
+        functions_t functions;
+        const auto  block = m_blocks.find( file_md5 );
+        if ( auto loaded = m_loaded.take( file_md5 ) ) {
+            functions = std::move( *loaded );
+        } else if ( block != m_blocks.end( ) ) {
+            functions = parse_block< functions_t >( m_snapshot.data( ).subspan( block->second.m_offset, block->second.m_size ),
+                                                    block->second.m_count );
+        }
+
+        // from here on m_size counts this binary by its results rather than by its snapshot block
+        if ( block != m_blocks.end( ) )
+            m_size -= block->second.m_count;
+        for ( const auto &[ address, results ] : functions ) {
+            m_size += results.size( );
+        }
+        m_dirty_bytes += footprint( functions );
+
+        return m_dirty.emplace( file_md5, std::move( functions ) ).first->second;
+    }
+
+    void c_analysis_cache::map_snapshot( ) {
+        m_blocks.clear( );
+        m_size = 0;
+        for ( const auto &[ file_md5, functions ] : m_dirty ) {
+            for ( const auto &[ address, results ] : functions ) {
+                m_size += results.size( );
+            }
+        }
+
+        if ( !m_snapshot.open( m_path ) || m_snapshot.empty( ) )
+            return;
+
+        const auto data = m_snapshot.data( );
+        reader_t   reader { data };
+
+        std::array< char, 8 > magic { };
+        std::uint32_t         version = 0;
+        std::uint32_t         count   = 0;
+        if ( !reader.read( magic ) || magic != k_magic || !reader.read( version ) || version != k_version || !reader.read( count ) ) {
+            m_snapshot.close( );
+            return;
+        }
+
+        std::unordered_map< std::string, file_block_t > blocks;
+        std::size_t                                     total = 0;
+        for ( std::uint32_t i = 0; i < count; i++ ) {
+            std::uint32_t    key_length = 0;
+            file_block_t     block;
+            std::string_view file_md5;
+
+            const bool valid = reader.read( key_length ) && reader.read( block.m_count ) && reader.read( block.m_offset )
+                            && reader.read( block.m_size ) && reader.read_bytes( key_length, file_md5 )
+                            && block.m_offset <= data.size( ) && block.m_size <= data.size( ) - block.m_offset;
+            if ( !valid ) {
+                // a damaged directory makes every offset suspect
+                m_snapshot.close( );
+                return;
+            }
+
+            auto key = std::string( file_md5 );
+            if ( !m_dirty.contains( key ) )
+                total += block.m_count;
+            blocks.emplace( std::move( key ), block );
+        }
+
+        m_blocks  = std::move( blocks );
+        m_size   += total;
+    }
+
+    void c_analysis_cache::apply( const json_t &record ) {
+        const auto op       = record.at( "op" ).get< std::string >( );
+        const auto file_md5 = record.at( "md5" ).get< std::string >( );
+        const auto address  = record.at( "addr" ).get< std::string >( );
+
+        auto &functions = modify( file_md5 );
+
+        if ( op == "put" ) {
+            const auto [ function, added ] = functions.try_emplace( address );
+            auto      &results             = function->second;
+            if ( added )
+                m_dirty_bytes += footprint( function->first, results );
+
+            auto type = record.at( "type" ).get< std::string >( );
+            if ( const auto old = results.find( type ); old != results.end( ) ) {
+                m_dirty_bytes -= footprint( old->first, old->second );
+            } else {
+                m_size++;
+            }
+
+            const auto slot  = results.insert_or_assign( std::move( type ), record.at( "result" ).get< std::string >( ) ).first;
+            m_dirty_bytes   += footprint( slot->first, slot->second );
+        } else if ( op == "erase" ) {
+            if ( const auto function = functions.find( address ); function != functions.end( ) ) {
+                m_size        -= function->second.size( );
+                m_dirty_bytes -= footprint( function->first, function->second );
+                functions.erase( function );
+            }
+        }
+        fit_budget( );
+    }
+
+    void c_analysis_cache::compact_if_pinned( ) {
+        {
+            const std::lock_guard< std::mutex > lk( m_mutex );
+            if ( m_budget == 0 || m_dirty_bytes <= m_retry_bytes + m_budget / k_pinned_fraction )
+                return;
+        }
+
+        if ( m_compacting.exchange( true ) )
+            return;
+
+        // the last compactor cleared m_compacting on its way out and no longer needs m_journal_mutex
+        if ( m_compactor.joinable( ) )
+            m_compactor.join( );
+
+        // readers are not blocked while it writes; puts queue on m_journal_mutex behind it
+        m_compactor = std::thread( [ this ] {
+            const bool compacted = compact( );
+            {
+                // a failing disk gets another try only after another share of the budget has changed
+                const std::lock_guard< std::mutex > lk( m_mutex );
+                m_retry_bytes = compacted ? 0 : m_dirty_bytes;
+            }
+            m_compacting = false;
+        } );
+    }
+
+    void c_analysis_cache::join_compactor( ) {
+        std::thread compactor;
+        {
+            const std::lock_guard< std::mutex > journal_lk( m_journal_mutex );
+            compactor = std::move( m_compactor );
+        }
+        if ( compactor.joinable( ) )
+            compactor.join( );
+    }
+
+    void c_analysis_cache::fit_budget( ) {
+        // over budget on changed binaries alone, the LRU still keeps the binary parsed last
+        m_loaded.set_capacity( m_budget == 0 ? 0 : std::max< std::size_t >( m_budget - std::min( m_dirty_bytes, m_budget ), 1 ) );
+    }
+
+    bool c_analysis_cache::append( const json_t &record ) {
+        if ( !m_journal )
+            return false;
+
+        const auto line = dump_line( record );
+        if ( std::fwrite( line.data( ), 1, line.size( ), m_journal ) != line.size( ) || !sync( m_journal ) )
+            return false;
+
+        m_journal_records++;
+        return true;
+    }
+
+    bool c_analysis_cache::compact_locked( ) {
+        if ( m_path.empty( ) )
+            return false;
+
+        // m_dirty, m_blocks and m_snapshot only change with m_journal_mutex held too, so the new snapshot is written
+        // from them without m_mutex: readers are not held up while the mapping is paged in and copied
+        struct directory_entry_t {
+            const std::string  *m_file_md5 { nullptr };
+            const functions_t  *m_functions { nullptr }; // changed binary, encoded from memory
+            const file_block_t *m_block { nullptr };     // unchanged binary, copied byte for byte
+            std::uint32_t       m_count { 0 };
+            std::uint64_t       m_size { 0 };
+        };
+
+        std::vector< directory_entry_t > directory;
+        for ( const auto &[ file_md5, functions ] : m_dirty ) {
+            directory_entry_t entry { &file_md5, &functions };
+            for ( const auto &[ address, results ] : functions ) {
+                for ( const auto &[ type, result ] : results ) {
+                    entry.m_count++;
+                    entry.m_size += k_record_header + address.size( ) + type.size( ) + result.size( );
+                }
+            }
+            if ( entry.m_count > 0 )
+                directory.push_back( entry );
+        }
+
+        for ( const auto &[ file_md5, block ] : m_blocks ) {
+            if ( !m_dirty.contains( file_md5 ) )
+                directory.push_back( { &file_md5, nullptr, &block, block.m_count, block.m_size } );
+        }
+
+        // every size is known up front, so the directory goes first and the records are streamed after it
+        std::size_t header_size = k_header_size;
+        for ( const auto &entry : directory ) {
+            header_size += k_directory_header + entry.m_file_md5->size( );
+        }
+
+        std::string header;
+        header.reserve( header_size );
+        header.append( k_magic.data( ), k_magic.size( ) );
+        write( header, k_version );
+        write( header, static_cast< std::uint32_t >( directory.size( ) ) );
+
+        std::uint64_t offset = header_size;
+        for ( const auto &entry : directory ) {
+            write( header, static_cast< std::uint32_t >( entry.m_file_md5->size( ) ) );
+            write( header, entry.m_count );
+            write( header, offset );
+            write( header, entry.m_size );
+            header.append( *entry.m_file_md5 );
+            offset += entry.m_size;
+        }
+
+        // write beside the old snapshot and rename over it: a crash leaves one complete file or the other
+        auto tmp_path  = m_path;
+        tmp_path      += ".tmp";
+
+        std::FILE *tmp = nullptr;
+        IDA_RE_FOPEN( tmp, tmp_path.string( ).c_str( ), "wb" );
+        if ( !tmp )
+            return false;
+
+        const auto put_bytes = [ tmp ]( const void *data, std::size_t size ) { return std::fwrite( data, 1, size, tmp ) == size; };
+
+        std::string buffer;
+        const auto  flush = [ & ] {
+            const bool ok = put_bytes( buffer.data( ), buffer.size( ) );
+            buffer.clear( );
+            return ok;
+        };
+
+        bool written = put_bytes( header.data( ), header.size( ) );
+        for ( const auto &entry : directory ) {
+            if ( !written )
+                break;
+
+            if ( entry.m_block ) {
+                const auto bytes = m_snapshot.data( ).subspan( entry.m_block->m_offset, entry.m_block->m_size );
+                written          = flush( ) && put_bytes( bytes.data( ), bytes.size( ) );
+                continue;
+            }
+
+            for ( const auto &[ address, results ] : *entry.m_functions ) {
+                for ( const auto &[ type, result ] : results ) {
+                    write_record( buffer, address, type, result );
+                }
+                if ( buffer.size( ) >= k_write_buffer )
+                    written = written && flush( );
+            }
+        }
+        written = written && flush( ) && sync( tmp );
+        std::fclose( tmp );
+
+        std::error_code ec;
+        if ( !written ) {
+            std::filesystem::remove( tmp_path, ec );
+            return false;
+        }
+
+        {
+            const std::lock_guard< std::mutex > lk( m_mutex );
+            m_snapshot.close( ); // Windows cannot replace a mapped file
+            std::filesystem::rename( tmp_path, m_path, ec );
+
+            // what changed is in the snapshot now, so it may be evicted like anything parsed from it
+            if ( !ec ) {
+                m_dirty_bytes = 0;
+                fit_budget( );
+                for ( auto &[ file_md5, functions ] : m_dirty ) {
+                    if ( functions.empty( ) )
+                        continue;
+
+                    const auto bytes = footprint( functions );
+                    m_loaded.put( file_md5, std::move( functions ), bytes );
+                }
+                m_dirty.clear( );
+            }
+            map_snapshot( ); // the new snapshot, or the old one again if the rename failed
+        }
+        if ( ec )
+            return false;
+        sync_directory( m_path.parent_path( ) );
+
+        // every journal record is in the snapshot now
+        if ( m_journal )
+            std::fclose( m_journal );
+        IDA_RE_FOPEN( m_journal, m_journal_path.string( ).c_str( ), "wb" );
+        m_journal_records = 0;
+        return m_journal != nullptr;
+    }
+} // namespace ida_re::utils
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "lru_cache.hpp"
+#include "mapped_file.hpp"
+
+namespace ida_re::utils {
+    // Analysis results keyed by file_md5 -> address -> analysis type, persisted as a memory-mapped binary
+    // snapshot plus an append-only journal next to it.
+    //
+    // The snapshot starts with a directory of binaries (file_md5 -> where its records are); open( ) reads
+    // only that, and a binary's records are parsed the first time one of its results is asked for, into
+    // an LRU bounded by set_memory_budget( ). An evicted binary is parsed from the mapping again on its
+    // next miss, so startup time and resident memory do not grow with the number of cached binaries.
+    // Binaries changed since the snapshot are only in the journal and stay in memory until the next
+    // compaction. They count against the budget, so the LRU shrinks to make room for them, and once they
+    // pass 1 / k_pinned_fraction of it put( ) and erase( ) start a compaction on a background thread:
+    // with a budget set, changed binaries stay near that share of it however long the session runs.
+    //
+    // put( ) and erase( ) append one JSON line to the journal and fsync it, so saving a result costs
+    // O(record) however large the cache is. compact( ) writes a new snapshot to a temporary file, fsyncs
+    // it and renames it over the old one, so a crash leaves either snapshot intact; binaries that were
+    // not changed are copied across byte for byte. A torn last journal line is dropped on open( ).
+    // Thread-safe.
+    class c_analysis_cache {
+      public:
+        c_analysis_cache( ) = default;
+        ~c_analysis_cache( );
+
+        c_analysis_cache( const c_analysis_cache & )            = delete;
+        c_analysis_cache &operator=( const c_analysis_cache & ) = delete;
+
+        // Maps the snapshot at path, replays its journal and keeps the journal open for appends. When
+        // there is no snapshot yet, a JSON cache at legacy_path ({ md5: { address: { type: result } } },
+        // the format before the binary snapshot) is imported into a new one.
+        bool open( const std::filesystem::path &path, const std::filesystem::path &legacy_path = { } );
+
+        // Compacts when the journal has grown past k_compact_records, then closes it
+        void close( );
+
+        [[nodiscard]] std::optional< std::string > find( std::string_view file_md5, std::string_view address, std::string_view type );
+
+        // Presence check for markers drawn every frame: not counted as a hit or miss, no recency update,
+        // and an unparsed binary is searched in the mapping rather than parsed into the LRU
+        [[nodiscard]] bool contains( std::string_view file_md5, std::string_view address, std::string_view type ) const;
+
+        void put( std::string_view file_md5, std::string_view address, std::string_view type, std::string_view result );
+
+        // drops every result of one function
+        void erase( std::string_view file_md5, std::string_view address );
+
+        // drops everything and deletes the files
+        void clear( );
+
+        // Rewrites the snapshot and empties the journal
+        bool compact( );
+
+        [[nodiscard]] std::size_t size( ) const;
+
+        // bytes of parsed binaries kept in memory; 0 = unbounded
+        void set_memory_budget( std::size_t bytes );
+
+        // hits, misses and evictions of the parsed-binary LRU; m_pinned_bytes are the changed binaries
+        [[nodiscard]] lru_stats_t stats( ) const;
+
+        // Visits every result with the cache locked, reading unchanged binaries straight from the mapping
+        // without parsing them into the LRU. fn must not call back into the cache.
+        void for_each( const std::function< void( std::string_view file_md5, std::string_view address, std::string_view type,
+                                                  std::string_view result ) > &fn ) const;
+
+      private:
+        using function_results_t = std::unordered_map< std::string, std::string >;        // type -> result
+        using functions_t        = std::unordered_map< std::string, function_results_t >; // address -> results
+
+        // one binary's records in the mapped snapshot
+        struct file_block_t {
+            std::uint64_t m_offset { 0 };
+            std::uint64_t m_size { 0 };
+            std::uint32_t m_count { 0 };
+        };
+
+        // A binary's results for reading: changed, already parsed or parsed now; nullptr when unknown.
+        // Valid until the next call that takes m_mutex.
+        const functions_t *lookup( const std::string &file_md5 ); // m_mutex held
+
+        // A binary's results for changing. Moves it out of the LRU, which only holds what the snapshot has.
+        functions_t &modify( const std::string &file_md5 ); // m_mutex held
+
+        void map_snapshot( );                // m_mutex held
+        void fit_budget( );                  // m_mutex held; gives the LRU what the changed binaries leave of m_budget
+        void apply( const json_t &record );  // m_mutex held
+        bool append( const json_t &record ); // m_journal_mutex held
+        bool compact_locked( );              // m_journal_mutex held
+        void compact_if_pinned( );           // m_journal_mutex held; starts m_compactor past the pinned share
+        void join_compactor( );              // m_journal_mutex not held
+
+        // journal length at which close( ) folds it into the snapshot
+        static constexpr std::size_t k_compact_records = 64;
+
+        // changed binaries may hold up to m_budget / k_pinned_fraction before a background compaction
+        static constexpr std::size_t k_pinned_fraction = 4;
+
+        // lock order: m_journal_mutex, then m_mutex. Readers only take m_mutex, so a put( ) waiting
+        // on the disk never stalls the UI thread. m_dirty, m_blocks and m_snapshot change only with both
+        // held, so compaction reads them under m_journal_mutex alone and takes m_mutex just to swap in
+        // the new snapshot.
+        mutable std::mutex                              m_mutex { };
+        std::mutex                                      m_journal_mutex { };
+        c_mapped_file                                   m_snapshot { };
+        std::unordered_map< std::string, file_block_t > m_blocks { }; // the snapshot's directory
+        std::unordered_map< std::string, functions_t >  m_dirty { };  // changed since the snapshot
+        c_lru_cache< std::string, functions_t >         m_loaded { }; // parsed from the snapshot
+        std::size_t                                     m_budget { 0 };      // set_memory_budget( ), 0 = unbounded
+        std::size_t                                     m_dirty_bytes { 0 }; // footprint of m_dirty
+        std::size_t                                     m_retry_bytes { 0 }; // m_dirty_bytes when a background compaction failed
+        std::size_t                                     m_size { 0 };
+        std::filesystem::path                           m_path { };
+        std::filesystem::path                           m_journal_path { };
+        std::filesystem::path                           m_legacy_path { };
+        std::FILE                                      *m_journal { nullptr };
+        std::size_t                                     m_journal_records { 0 };
+        std::thread                                     m_compactor { }; // guarded by m_journal_mutex
+        std::atomic< bool >                             m_compacting { false };
+    };
+} // namespace ida_re::utils
@@ -0,0 +1,108 @@
+#include "vendor.hpp"
+#include "code_fingerprint.hpp"
+
+#include <openssl/evp.h>
+
+namespace ida_re::utils {
+    namespace {
+        // names IDA derives from an address; the rest of the name is the address in hex
+        constexpr std::array< std::string_view, 20 > k_auto_name_prefixes {
+            "sub_",   "j_sub_",  "nullsub_", "loc_",    "locret_", "off_", "seg_", "byte_", "word_", "dword_",
+            "qword_", "xmmword_", "ymmword_", "unk_", "stru_",   "asc_", "flt_", "dbl_",  "algn_", "funcs_"
+        };
+
+        bool is_word_char( char c ) noexcept {
+            return std::isalnum( static_cast< unsigned char >( c ) ) || c == '_';
+        }
+    } // namespace
+
+    std::string_view auto_name_prefix( std::string_view word ) noexcept {
+        for ( const auto prefix : k_auto_name_prefixes ) {
+            if ( word.size( ) > prefix.size( ) && word.starts_with( prefix )
+                 && std::ranges::all_of( word.substr( prefix.size( ) ),
+                                         []( char c ) { return std::isxdigit( static_cast< unsigned char >( c ) ) != 0; } ) )
+                return prefix;
+        }
+        return { };
+    }
+
+    std::string normalize_pseudocode( std::string_view code ) {
+        std::string                                         out;
+        std::unordered_map< std::string_view, std::size_t > auto_names;
+        bool                                                pending_space = false;
+
+        out.reserve( code.size( ) );
+
+        // a space survives only where dropping it would join two words
+        const auto emit = [ & ]( std::string_view token ) {
+            if ( pending_space && !out.empty( ) && is_word_char( out.back( ) ) && is_word_char( token.front( ) ) )
+                out.push_back( ' ' );
+            pending_space = false;
+            out.append( token );
+        };
+
+        for ( std::size_t i = 0; i < code.size( ); ) {
+            const char c = code[ i ];
+
+            if ( std::isspace( static_cast< unsigned char >( c ) ) ) {
+                pending_space = true;
+                i++;
+            } else if ( code.substr( i, 2 ) == "//" ) {
+                i             = std::min( code.find( '\n', i ), code.size( ) );
+                pending_space = true;
+            } else if ( code.substr( i, 2 ) == "/*" ) {
+                const auto end = code.find( "*/", i + 2 );
+                i              = end == std::string_view::npos ? code.size( ) : end + 2;
+                pending_space  = true;
+            } else if ( c == '"' || c == '\'' ) {
+                // literals are copied verbatim, escapes included
+                std::size_t end = i + 1;
+                while ( end < code.size( ) && code[ end ] != c ) {
+                    end += code[ end ] == '\\' ? 2 : 1;
+                }
+                end = std::min( end + 1, code.size( ) );
+                emit( code.substr( i, end - i ) );
+                i = end;
+            } else if ( is_word_char( c ) ) {
+                std::size_t end = i;
+                while ( end < code.size( ) && is_word_char( code[ end ] ) ) {
+                    end++;
+                }
+
+                const auto word   = code.substr( i, end - i );
+                const auto prefix = auto_name_prefix( word );
+                if ( prefix.empty( ) ) {
+                    emit( word );
+                } else {
+                    const auto [ it, inserted ] = auto_names.try_emplace( word, auto_names.size( ) );
+                    emit( prefix );
+                    out.push_back( '#' );
+                    out.append( std::to_string( it->second ) );
+                }
+                i = end;
+            } else {
+                emit( code.substr( i, 1 ) );
+                i++;
+            }
+        }
+
+        return out;
+    }
+
+    std::string sha256_hex( std::string_view data ) {
+        std::array< unsigned char, EVP_MAX_MD_SIZE > digest { };
+        unsigned int                                 length = 0;
+        if ( !EVP_Digest( data.data( ), data.size( ), digest.data( ), &length, EVP_sha256( ), nullptr ) )
+            return { };
+
+        static constexpr char k_hex[] = "0123456789abcdef";
+
+        std::string out;
+        out.reserve( length * 2 );
+        for ( unsigned int i = 0; i < length; i++ ) {
+            out.push_back( k_hex[ digest[ i ] >> 4 ] );
+            out.push_back( k_hex[ digest[ i ] & 0xf ] );
+        }
+        return out;
+    }
+} // namespace ida_re::utils
@@ -0,0 +1,20 @@
+#pragma once
+
+namespace ida_re::utils {
+    // Pseudocode reduced to what decides an analysis: comments are dropped, whitespace is collapsed and
+    // address-derived IDA names (sub_401000, dword_40A0C0, loc_...) are numbered in order of first use.
+    // The same function therefore normalizes the same in any binary or IDB it is decompiled from, while
+    // any real change to the code (or a user-chosen name) changes the result.
+    [[nodiscard]] std::string normalize_pseudocode( std::string_view code );
+
+    // The prefix of an address-derived IDA name ("sub_" for sub_401000), or an empty view for any other word
+    [[nodiscard]] std::string_view auto_name_prefix( std::string_view word ) noexcept;
+
+    // lower-case hex SHA-256
+    [[nodiscard]] std::string sha256_hex( std::string_view data );
+
+    // content address of a function: SHA-256 of its normalized pseudocode
+    [[nodiscard]] inline std::string pseudocode_fingerprint( std::string_view code ) {
+        return sha256_hex( normalize_pseudocode( code ) );
+    }
+} // namespace ida_re::utils
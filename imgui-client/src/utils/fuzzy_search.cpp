@@ -0,0 +1,352 @@
+#include "vendor.hpp"
+
+#include "fuzzy_search.hpp"
+
+namespace ida_re::utils {
+    namespace {
+        // scoring constants follow fzf's v1 algorithm
+        constexpr int k_score_match       = 16;
+        constexpr int k_score_gap_start   = -3;
+        constexpr int k_score_gap_extend  = -1;
+        constexpr int k_bonus_boundary    = 8;
+        constexpr int k_bonus_camel       = 7;
+        constexpr int k_bonus_consecutive = 4;
+        constexpr int k_bonus_first_mult  = 2;
+
+        // how many entries are scanned between cancellation checks
+        constexpr std::uint32_t k_cancel_check_interval = 4096;
+
+        enum class e_char_class {
+            other,
+            lower,
+            upper,
+            digit
+        };
+
+        e_char_class classify( char c ) noexcept {
+            if ( c >= 'a' && c <= 'z' )
+                return e_char_class::lower;
+            if ( c >= 'A' && c <= 'Z' )
+                return e_char_class::upper;
+            if ( c >= '0' && c <= '9' )
+                return e_char_class::digit;
+            return e_char_class::other;
+        }
+
+        int bonus_at( std::string_view text, std::size_t i ) noexcept {
+            const auto cur = classify( text[ i ] );
+            if ( i == 0 )
+                return cur == e_char_class::other ? 0 : k_bonus_boundary;
+
+            const auto prev = classify( text[ i - 1 ] );
+            if ( prev == e_char_class::other && cur != e_char_class::other )
+                return k_bonus_boundary; // sub_, ::, _start
+            if ( prev == e_char_class::lower && cur == e_char_class::upper )
+                return k_bonus_camel; // cryptoInit
+            if ( prev != e_char_class::digit && cur == e_char_class::digit )
+                return k_bonus_camel; // sha256
+            return 0;
+        }
+
+        std::string to_lower( std::string_view text ) {
+            std::string lower( text );
+            std::transform( lower.begin( ), lower.end( ), lower.begin( ), []( unsigned char c ) { return static_cast< char >( std::tolower( c ) ); } );
+            return lower;
+        }
+
+        // Highest score an entry whose name does not contain the pattern can get: every character on a
+        // boundary, the first one doubled, and at least one gap. Typing part of an address scores above that.
+        int outside_candidates_bound( std::string_view lower_pattern ) noexcept {
+            const int length    = static_cast< int >( lower_pattern.size( ) );
+            const int scattered = length * ( k_score_match + k_bonus_boundary ) + k_bonus_boundary * ( k_bonus_first_mult - 1 )
+                                + k_score_gap_start;
+
+            const auto is_address_char = []( char c ) { return std::isxdigit( static_cast< unsigned char >( c ) ) != 0 || c == 'x'; };
+            if ( !std::ranges::all_of( lower_pattern, is_address_char ) )
+                return scattered;
+            return std::max( scattered, length * ( k_score_match + k_bonus_boundary ) * 2 );
+        }
+
+        constexpr std::uint32_t trigram_key( std::string_view s, std::size_t i ) noexcept {
+            return ( static_cast< std::uint32_t >( static_cast< unsigned char >( s[ i ] ) ) << 16 )
+                 | ( static_cast< std::uint32_t >( static_cast< unsigned char >( s[ i + 1 ] ) ) << 8 )
+                 | static_cast< std::uint32_t >( static_cast< unsigned char >( s[ i + 2 ] ) );
+        }
+    } // namespace
+
+    std::optional< int > c_fuzzy_index::score( std::string_view pattern, std::string_view text, std::string_view lower ) {
+        if ( pattern.empty( ) || pattern.size( ) > lower.size( ) )
+            return std::nullopt;
+
+        // forward pass: earliest position where the whole pattern has been seen
+        std::size_t pi  = 0;
+        std::size_t end = std::string_view::npos;
+        for ( std::size_t i = 0; i < lower.size( ); i++ ) {
+            if ( lower[ i ] == pattern[ pi ] && ++pi == pattern.size( ) ) {
+                end = i;
+                break;
+            }
+        }
+
+        if ( end == std::string_view::npos )
+            return std::nullopt;
+
+        // backward pass: tighten the window to the latest start that still matches
+        std::size_t start = end;
+        pi                = pattern.size( ) - 1;
+        for ( std::size_t i = end + 1; i-- > 0; ) {
+            if ( lower[ i ] == pattern[ pi ] ) {
+                if ( pi == 0 ) {
+                    start = i;
+                    break;
+                }
+                pi--;
+            }
+        }
+
+        int  score       = 0;
+        int  first_bonus = 0;
+        int  run         = 0;
+        bool in_gap      = false;
+        pi               = 0;
+
+        for ( std::size_t i = start; i <= end; i++ ) {
+            if ( pi < pattern.size( ) && lower[ i ] == pattern[ pi ] ) {
+                int bonus = bonus_at( text, i );
+                if ( run == 0 ) {
+                    first_bonus = bonus;
+                } else {
+                    // a run inherits the bonus of the boundary it started on
+                    if ( bonus >= k_bonus_boundary && bonus > first_bonus )
+                        first_bonus = bonus;
+                    bonus = std::max( { bonus, first_bonus, k_bonus_consecutive } );
+                }
+
+                if ( pi == 0 )
+                    bonus *= k_bonus_first_mult;
+
+                score  += k_score_match + bonus;
+                in_gap  = false;
+                run++;
+                pi++;
+            } else {
+                score  += in_gap ? k_score_gap_extend : k_score_gap_start;
+                in_gap  = true;
+                run     = 0;
+            }
+        }
+
+        return score;
+    }
+
+    void c_fuzzy_index::build( std::vector< fuzzy_entry_t > entries ) {
+        m_entries = std::move( entries );
+        m_lower_names.clear( );
+        m_lower_addresses.clear( );
+        m_trigrams.clear( );
+
+        m_lower_names.reserve( m_entries.size( ) );
+        m_lower_addresses.reserve( m_entries.size( ) );
+
+        for ( std::uint32_t i = 0; i < m_entries.size( ); i++ ) {
+            m_lower_names.push_back( to_lower( m_entries[ i ].m_name ) );
+            m_lower_addresses.push_back( to_lower( m_entries[ i ].m_address ) );
+
+            const auto &name = m_lower_names.back( );
+            for ( std::size_t j = 0; j + 2 < name.size( ); j++ ) {
+                auto &postings = m_trigrams[ trigram_key( name, j ) ];
+                if ( postings.empty( ) || postings.back( ) != i ) {
+                    postings.push_back( i );
+                }
+            }
+        }
+    }
+
+    std::optional< std::vector< fuzzy_match_t > > c_fuzzy_index::query( std::string_view pattern, std::size_t limit,
+                                                                         const cancel_fn_t &cancelled ) const {
+        std::vector< fuzzy_match_t > matches;
+
+        std::string lower_pattern;
+        for ( char c : pattern ) {
+            if ( c != ' ' )
+                lower_pattern.push_back( static_cast< char >( std::tolower( static_cast< unsigned char >( c ) ) ) );
+        }
+
+        if ( lower_pattern.empty( ) || m_entries.empty( ) || limit == 0 )
+            return matches;
+
+        std::vector< std::uint8_t > seen( m_entries.size( ), 0 );
+        std::uint32_t               visited = 0;
+        bool                        stop    = false;
+
+        const auto try_entry = [ & ]( std::uint32_t i ) {
+            if ( ++visited % k_cancel_check_interval == 0 && cancelled && cancelled( ) ) {
+                stop = true;
+                return;
+            }
+
+            if ( seen[ i ] )
+                return;
+            seen[ i ] = 1;
+
+            auto match = score( lower_pattern, m_entries[ i ].m_name, m_lower_names[ i ] );
+
+            // typing part of an address should jump straight to it
+            if ( m_lower_addresses[ i ].find( lower_pattern ) != std::string::npos ) {
+                const int address_score = static_cast< int >( lower_pattern.size( ) ) * ( k_score_match + k_bonus_boundary ) * 2;
+                match                   = std::max( match.value_or( 0 ), address_score );
+            }
+
+            if ( match ) {
+                matches.push_back( { i, *match } );
+            }
+        };
+
+        // a name containing the pattern contains every one of its trigrams, so the rarest trigram's postings
+        // hold all contiguous matches, which usually rank best; "sub" alone would list nearly every entry
+        if ( lower_pattern.size( ) >= 3 ) {
+            const std::vector< std::uint32_t > *rarest = nullptr;
+            for ( std::size_t j = 0; j + 2 < lower_pattern.size( ); j++ ) {
+                const auto it = m_trigrams.find( trigram_key( lower_pattern, j ) );
+                if ( it == m_trigrams.end( ) ) {
+                    rarest = nullptr;
+                    break;
+                }
+
+                if ( !rarest || it->second.size( ) < rarest->size( ) )
+                    rarest = &it->second;
+            }
+
+            if ( rarest ) {
+                for ( const auto i : *rarest ) {
+                    try_entry( i );
+                    if ( stop )
+                        break;
+                }
+            }
+        }
+
+        const auto better = [ this ]( const fuzzy_match_t &a, const fuzzy_match_t &b ) {
+            if ( a.m_score != b.m_score )
+                return a.m_score > b.m_score;
+
+            const auto &ea = m_entries[ a.m_index ];
+            const auto &eb = m_entries[ b.m_index ];
+            if ( ea.m_size != eb.m_size )
+                return ea.m_size > eb.m_size;
+            if ( ea.m_name.size( ) != eb.m_name.size( ) )
+                return ea.m_name.size( ) < eb.m_name.size( );
+            return a.m_index < b.m_index;
+        };
+
+        // Scattered matches (initials, an address) share no trigram with the pattern. The rest is skipped only
+        // when the trigram pass alone fills limit with scores that nothing outside it can reach or tie.
+        bool full_scan = lower_pattern.size( ) < 3 || matches.size( ) < limit;
+        if ( !full_scan && !stop ) {
+            const auto nth = matches.begin( ) + static_cast< std::ptrdiff_t >( limit - 1 );
+            std::nth_element( matches.begin( ), nth, matches.end( ), better );
+            full_scan = nth->m_score <= outside_candidates_bound( lower_pattern );
+        }
+
+        if ( full_scan ) {
+            for ( std::uint32_t i = 0; i < m_entries.size( ) && !stop; i++ ) {
+                try_entry( i );
+            }
+        }
+
+        if ( stop )
+            return std::nullopt;
+
+        if ( matches.size( ) > limit ) {
+            std::partial_sort( matches.begin( ), matches.begin( ) + static_cast< std::ptrdiff_t >( limit ), matches.end( ), better );
+            matches.resize( limit );
+        } else {
+            std::sort( matches.begin( ), matches.end( ), better );
+        }
+
+        return matches;
+    }
+
+    c_fuzzy_search::c_fuzzy_search( ) : m_worker( &c_fuzzy_search::worker_loop, this ) { }
+
+    c_fuzzy_search::~c_fuzzy_search( ) {
+        {
+            std::lock_guard< std::mutex > lock( m_mutex );
+            m_stopping = true;
+            ++m_query_generation;
+        }
+        m_cv.notify_one( );
+
+        if ( m_worker.joinable( ) )
+            m_worker.join( );
+    }
+
+    std::uint64_t c_fuzzy_search::set_entries( std::vector< fuzzy_entry_t > entries ) {
+        std::uint64_t generation;
+        {
+            std::lock_guard< std::mutex > lock( m_mutex );
+            m_pending_entries = std::move( entries );
+            generation        = ++m_entries_generation;
+            ++m_query_generation;
+        }
+        m_cv.notify_one( );
+        return generation;
+    }
+
+    void c_fuzzy_search::search( std::string pattern ) {
+        {
+            std::lock_guard< std::mutex > lock( m_mutex );
+            m_pending_pattern = std::move( pattern );
+            ++m_query_generation;
+        }
+        m_cv.notify_one( );
+    }
+
+    void c_fuzzy_search::worker_loop( ) {
+        std::uint64_t index_generation = 0;
+
+        for ( ;; ) {
+            std::optional< std::vector< fuzzy_entry_t > > entries;
+            std::string                                   pattern;
+            std::uint64_t                                 query_generation;
+            {
+                std::unique_lock< std::mutex > lock( m_mutex );
+                m_cv.wait( lock, [ this ] { return m_stopping || m_pending_entries || m_pending_pattern; } );
+                if ( m_stopping )
+                    return;
+
+                if ( m_pending_entries ) {
+                    entries = std::move( m_pending_entries );
+                    m_pending_entries.reset( );
+                    index_generation = m_entries_generation;
+                }
+
+                if ( m_pending_pattern ) {
+                    m_last_pattern = std::move( *m_pending_pattern );
+                    m_pending_pattern.reset( );
+                }
+
+                pattern          = m_last_pattern;
+                query_generation = m_query_generation.load( std::memory_order_relaxed );
+            }
+
+            if ( entries ) {
+                m_index.build( std::move( *entries ) );
+                m_ready_generation.store( index_generation, std::memory_order_release );
+            }
+
+            // a rebuilt index re-runs the last pattern so results never refer to a stale entry set
+            auto matches = m_index.query( pattern, k_max_results, [ this, query_generation ] {
+                return m_query_generation.load( std::memory_order_relaxed ) != query_generation;
+            } );
+            if ( !matches )
+                continue;
+
+            auto results                = std::make_shared< results_t >( );
+            results->m_index_generation = index_generation;
+            results->m_pattern          = std::move( pattern );
+            results->m_matches          = std::move( *matches );
+            m_results.store( std::move( results ), std::memory_order_release );
+        }
+    }
+} // namespace ida_re::utils
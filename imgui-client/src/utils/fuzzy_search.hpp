@@ -0,0 +1,93 @@
+#pragma once
+
+namespace ida_re::utils {
+    struct fuzzy_entry_t {
+        std::string   m_name { };
+        std::string   m_address { };
+        std::uint64_t m_size { 0 };
+    };
+
+    struct fuzzy_match_t {
+        std::uint32_t m_index { 0 }; // position in the entry list the index was built from
+        int           m_score { 0 };
+    };
+
+    // fzf-style fuzzy matcher over a fixed symbol table. build( ) lowercases every name once and
+    // records which entries contain each trigram; query( ) scores the names containing the pattern
+    // first and skips the full subsequence scan only when they fill limit with scores no scattered
+    // match could reach, so the result is always the same as scoring every entry.
+    class c_fuzzy_index {
+      public:
+        using cancel_fn_t = std::function< bool( ) >;
+
+        void build( std::vector< fuzzy_entry_t > entries );
+
+        // Best matches first: by score, then larger functions, then shorter names.
+        // Returns std::nullopt if cancelled part way.
+        [[nodiscard]] std::optional< std::vector< fuzzy_match_t > > query( std::string_view pattern, std::size_t limit,
+                                                                           const cancel_fn_t &cancelled = { } ) const;
+
+        // Subsequence score of a lowercase pattern against text (lower is text lowercased), or std::nullopt
+        // if the pattern is not a subsequence. Word starts and camelCase humps score higher, as do runs.
+        [[nodiscard]] static std::optional< int > score( std::string_view pattern, std::string_view text, std::string_view lower );
+
+        [[nodiscard]] std::size_t size( ) const noexcept {
+            return m_entries.size( );
+        }
+
+      private:
+        std::vector< fuzzy_entry_t >                                      m_entries { };
+        std::vector< std::string >                                        m_lower_names { };
+        std::vector< std::string >                                        m_lower_addresses { };
+        std::unordered_map< std::uint32_t, std::vector< std::uint32_t > > m_trigrams { };
+    };
+
+    // Runs c_fuzzy_index builds and queries on a background thread. The newest request always wins;
+    // finished results are published through an atomic shared_ptr so the UI thread can read them
+    // every frame without locking.
+    class c_fuzzy_search {
+      public:
+        struct results_t {
+            std::uint64_t                m_index_generation { 0 };
+            std::string                  m_pattern { };
+            std::vector< fuzzy_match_t > m_matches { };
+        };
+
+        c_fuzzy_search( );
+        ~c_fuzzy_search( );
+
+        c_fuzzy_search( const c_fuzzy_search & )            = delete;
+        c_fuzzy_search &operator=( const c_fuzzy_search & ) = delete;
+
+        // Replaces the indexed entries; returns the generation that results for this entry set carry
+        std::uint64_t set_entries( std::vector< fuzzy_entry_t > entries );
+        void          search( std::string pattern );
+
+        [[nodiscard]] std::shared_ptr< const results_t > results( ) const {
+            return m_results.load( std::memory_order_acquire );
+        }
+
+        // generation of the entry set the worker has finished indexing
+        [[nodiscard]] std::uint64_t ready_generation( ) const noexcept {
+            return m_ready_generation.load( std::memory_order_acquire );
+        }
+
+      private:
+        void worker_loop( );
+
+        static constexpr std::size_t k_max_results = 5000;
+
+        c_fuzzy_index                                     m_index { }; // worker thread only
+        std::mutex                                        m_mutex { };
+        std::condition_variable                           m_cv { };
+        std::optional< std::vector< fuzzy_entry_t > >     m_pending_entries { };
+        std::optional< std::string >                      m_pending_pattern { };
+        std::string                                       m_last_pattern { };
+        bool                                              m_stopping { false };
+        std::uint64_t                                     m_entries_generation { 0 };
+        std::atomic< std::uint64_t >                      m_ready_generation { 0 };
+        std::atomic< std::uint64_t >                      m_query_generation { 0 };
+        std::atomic< std::shared_ptr< const results_t > > m_results { };
+        std::thread                                       m_worker { };
+    };
+} // namespace ida_re::utils
@@ -0,0 +1,140 @@
+#pragma once
+
+namespace ida_re::utils {
+    struct lru_stats_t {
+        std::uint64_t m_hits { 0 };
+        std::uint64_t m_misses { 0 };
+        std::uint64_t m_evictions { 0 };
+        std::uint64_t m_evicted_bytes { 0 };
+        std::size_t   m_entries { 0 };
+        std::size_t   m_bytes { 0 };
+        std::size_t   m_capacity { 0 };     // 0 = unbounded
+        std::size_t   m_pinned_bytes { 0 }; // held outside the LRU by its owner but counted against m_capacity
+    };
+
+    // Least-recently-used map bounded by bytes rather than entry count: put( ) is told what each value
+    // owns on the heap, and the cache adds its own per-entry overhead. Inserting past the capacity evicts
+    // from the cold end; the entry just inserted always stays, even when it alone is over budget.
+    // Not thread-safe; the owner locks.
+    template < typename key_t, typename value_t, typename hash_t = std::hash< key_t > >
+    class c_lru_cache {
+      public:
+        explicit c_lru_cache( std::size_t capacity = 0 ) : m_capacity( capacity ) { }
+
+        void set_capacity( std::size_t bytes ) {
+            m_capacity = bytes;
+            trim( );
+        }
+
+        // Marks the entry most recently used. The pointer is valid until the next put( ), take( ), erase( ) or clear( ).
+        [[nodiscard]] value_t *find( const key_t &key ) {
+            const auto it = m_index.find( key );
+            if ( it == m_index.end( ) ) {
+                m_stats.m_misses++;
+                return nullptr;
+            }
+
+            m_stats.m_hits++;
+            m_order.splice( m_order.begin( ), m_order, it->second );
+            return &it->second->m_value;
+        }
+
+        // no recency update, no hit or miss counted
+        [[nodiscard]] bool contains( const key_t &key ) const {
+            return m_index.contains( key );
+        }
+
+        // find( ) without the recency update or the hit and miss counters
+        [[nodiscard]] const value_t *peek( const key_t &key ) const {
+            const auto it = m_index.find( key );
+            return it != m_index.end( ) ? &it->second->m_value : nullptr;
+        }
+
+        value_t &put( key_t key, value_t value, std::size_t bytes ) {
+            bytes += k_entry_overhead;
+
+            if ( const auto it = m_index.find( key ); it != m_index.end( ) ) {
+                m_bytes                   -= it->second->m_bytes;
+                it->second->m_value        = std::move( value );
+                it->second->m_bytes        = bytes;
+                m_bytes                   += bytes;
+                m_order.splice( m_order.begin( ), m_order, it->second );
+            } else {
+                m_order.push_front( { key, std::move( value ), bytes } );
+                m_index.emplace( std::move( key ), m_order.begin( ) );
+                m_bytes += bytes;
+            }
+
+            trim( );
+            return m_order.front( ).m_value;
+        }
+
+        // removes the entry and hands it back; not counted as an eviction
+        [[nodiscard]] std::optional< value_t > take( const key_t &key ) {
+            const auto it = m_index.find( key );
+            if ( it == m_index.end( ) )
+                return std::nullopt;
+
+            auto value  = std::move( it->second->m_value );
+            m_bytes    -= it->second->m_bytes;
+            m_order.erase( it->second );
+            m_index.erase( it );
+            return value;
+        }
+
+        bool erase( const key_t &key ) {
+            return take( key ).has_value( );
+        }
+
+        // drops every entry; the counters keep running
+        void clear( ) {
+            m_order.clear( );
+            m_index.clear( );
+            m_bytes = 0;
+        }
+
+        [[nodiscard]] lru_stats_t stats( ) const noexcept {
+            auto stats       = m_stats;
+            stats.m_entries  = m_index.size( );
+            stats.m_bytes    = m_bytes;
+            stats.m_capacity = m_capacity;
+            return stats;
+        }
+
+        [[nodiscard]] std::size_t size( ) const noexcept {
+            return m_index.size( );
+        }
+
+      private:
+        struct node_t {
+            key_t       m_key;
+            value_t     m_value;
+            std::size_t m_bytes { 0 };
+        };
+
+        using order_t = std::list< node_t >;
+
+        // list node, hash node and bucket slot
+        static constexpr std::size_t k_entry_overhead = sizeof( node_t ) + 2 * sizeof( void * ) + sizeof( key_t ) + 3 * sizeof( void * );
+
+        void trim( ) {
+            if ( m_capacity == 0 )
+                return;
+
+            while ( m_bytes > m_capacity && m_order.size( ) > 1 ) {
+                auto &cold = m_order.back( );
+                m_stats.m_evictions++;
+                m_stats.m_evicted_bytes += cold.m_bytes;
+                m_bytes                 -= cold.m_bytes;
+                m_index.erase( cold.m_key );
+                m_order.pop_back( );
+            }
+        }
+
+        order_t                                                           m_order { }; // most recently used first
+        std::unordered_map< key_t, typename order_t::iterator, hash_t > m_index { };
+        std::size_t                                                       m_bytes { 0 };
+        std::size_t                                                       m_capacity { 0 };
+        lru_stats_t                                                       m_stats { };
+    };
+} // namespace ida_re::utils
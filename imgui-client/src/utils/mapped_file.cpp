@@ -0,0 +1,92 @@
+#include "vendor.hpp"
+#include "mapped_file.hpp"
+
+#ifndef IDA_RE_PLATFORM_WINDOWS
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
+namespace ida_re::utils {
+    c_mapped_file::~c_mapped_file( ) {
+        close( );
+    }
+
+    bool c_mapped_file::open( const std::filesystem::path &path ) {
+        close( );
+
+        std::error_code ec;
+        if ( !std::filesystem::exists( path, ec ) )
+            return true;
+
+#ifdef IDA_RE_PLATFORM_WINDOWS
+        m_file = CreateFileW( path.c_str( ), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr );
+        if ( m_file == INVALID_HANDLE_VALUE )
+            return false;
+
+        LARGE_INTEGER size { };
+        if ( !GetFileSizeEx( m_file, &size ) ) {
+            close( );
+            return false;
+        }
+        if ( size.QuadPart == 0 )
+            return true;
+
+        m_mapping = CreateFileMappingW( m_file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+        if ( !m_mapping ) {
+            close( );
+            return false;
+        }
+
+        m_data = static_cast< const std::byte * >( MapViewOfFile( m_mapping, FILE_MAP_READ, 0, 0, 0 ) );
+        if ( !m_data ) {
+            close( );
+            return false;
+        }
+        m_size = static_cast< std::size_t >( size.QuadPart );
+#else
+        const int fd = ::open( path.c_str( ), O_RDONLY );
+        if ( fd < 0 )
+            return false;
+
+        struct stat st { };
+        if ( ::fstat( fd, &st ) != 0 ) {
+            ::close( fd );
+            return false;
+        }
+        if ( st.st_size == 0 ) {
+            ::close( fd );
+            return true;
+        }
+
+        // the mapping keeps the file referenced; the descriptor is not needed past this point
+        void *data = ::mmap( nullptr, static_cast< std::size_t >( st.st_size ), PROT_READ, MAP_PRIVATE, fd, 0 );
+        ::close( fd );
+        if ( data == MAP_FAILED )
+            return false;
+
+        m_data = static_cast< const std::byte * >( data );
+        m_size = static_cast< std::size_t >( st.st_size );
+#endif
+        return true;
+    }
+
+    void c_mapped_file::close( ) noexcept {
+#ifdef IDA_RE_PLATFORM_WINDOWS
+        if ( m_data )
+            UnmapViewOfFile( m_data );
+        if ( m_mapping )
+            CloseHandle( m_mapping );
+        if ( m_file != INVALID_HANDLE_VALUE )
+            CloseHandle( m_file );
+        m_mapping = nullptr;
+        m_file    = INVALID_HANDLE_VALUE;
+#else
+        if ( m_data )
+            ::munmap( const_cast< std::byte * >( m_data ), m_size );
+#endif
+        m_data = nullptr;
+        m_size = 0;
+    }
+} // namespace ida_re::utils
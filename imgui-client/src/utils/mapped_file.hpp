@@ -0,0 +1,36 @@
+#pragma once
+
+namespace ida_re::utils {
+    // Read-only memory mapping of a whole file. Pages are loaded by the OS on first touch, so opening
+    // a large file costs the same as opening a small one. An empty or missing file maps to an empty span.
+    class c_mapped_file {
+      public:
+        c_mapped_file( ) = default;
+        ~c_mapped_file( );
+
+        c_mapped_file( const c_mapped_file & )            = delete;
+        c_mapped_file &operator=( const c_mapped_file & ) = delete;
+
+        // Maps path, replacing any previous mapping. False when the file exists but cannot be mapped.
+        bool open( const std::filesystem::path &path );
+
+        // Unmaps; required on Windows before the file can be replaced or deleted
+        void close( ) noexcept;
+
+        [[nodiscard]] std::span< const std::byte > data( ) const noexcept {
+            return { m_data, m_size };
+        }
+
+        [[nodiscard]] bool empty( ) const noexcept {
+            return m_size == 0;
+        }
+
+      private:
+        const std::byte *m_data { nullptr };
+        std::size_t      m_size { 0 };
+#ifdef IDA_RE_PLATFORM_WINDOWS
+        HANDLE m_file { INVALID_HANDLE_VALUE };
+        HANDLE m_mapping { nullptr };
+#endif
+    };
+} // namespace ida_re::utils
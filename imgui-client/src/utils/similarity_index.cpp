@@ -0,0 +1,348 @@
+#include "vendor.hpp"
+#include "similarity_index.hpp"
+
+#include "code_fingerprint.hpp"
+
+namespace ida_re::utils {
+    namespace {
+        // FNV-1a, then a splitmix64 finalizer so every output bit depends on every input byte
+        std::uint64_t feature_hash( std::span< const std::string_view > tokens ) noexcept {
+            std::uint64_t hash = 14695981039346656037ull;
+            for ( const auto token : tokens ) {
+                for ( const char c : token ) {
+                    hash ^= static_cast< std::uint8_t >( c );
+                    hash *= 1099511628211ull;
+                }
+                hash ^= 0xff; // token separator
+                hash *= 1099511628211ull;
+            }
+
+            hash ^= hash >> 30;
+            hash *= 0xbf58476d1ce4e5b9ull;
+            hash ^= hash >> 27;
+            hash *= 0x94d049bb133111ebull;
+            hash ^= hash >> 31;
+            return hash;
+        }
+
+        // v12 -> v, a3 -> a: the decompiler renumbers locals whenever a variable is added or removed
+        bool is_numbered_local( std::string_view token ) noexcept {
+            return token.size( ) > 1 && ( token.front( ) == 'v' || token.front( ) == 'a' )
+                && std::ranges::all_of( token.substr( 1 ), []( char c ) { return std::isdigit( static_cast< unsigned char >( c ) ) != 0; } );
+        }
+
+        std::string_view fold_token( std::string_view token ) noexcept {
+            if ( const auto prefix = auto_name_prefix( token ); !prefix.empty( ) )
+                return prefix;
+            if ( is_numbered_local( token ) )
+                return token.substr( 0, 1 );
+
+            // addresses and other long constants move between builds; small ones (sizes, flags, indices) say what the code does
+            if ( std::isdigit( static_cast< unsigned char >( token.front( ) ) ) && token.size( ) > 6 )
+                return "#";
+            return token;
+        }
+
+        std::string slot_key( std::string_view file_md5, std::string_view address ) {
+            std::string key( file_md5 );
+            key.push_back( '/' );
+            key.append( address );
+            return key;
+        }
+
+        std::string dump_line( const similar_function_t &entry ) {
+            const json_t record = {
+                {  "md5", entry.m_file_md5 },
+                { "addr",  entry.m_address },
+                { "name",     entry.m_name },
+                { "hash",  entry.m_simhash }
+            };
+
+            auto line = record.dump( -1, ' ', false, json_t::error_handler_t::replace );
+            line.push_back( '\n' );
+            return line;
+        }
+
+        std::string dump_erase_line( std::string_view file_md5, std::string_view address ) {
+            const json_t record = {
+                {    "md5", file_md5 },
+                {   "addr",  address },
+                { "erased",     true }
+            };
+
+            auto line = record.dump( -1, ' ', false, json_t::error_handler_t::replace );
+            line.push_back( '\n' );
+            return line;
+        }
+    } // namespace
+
+    c_similarity_index::~c_similarity_index( ) {
+        close( );
+    }
+
+    std::uint64_t c_similarity_index::simhash( std::span< const std::string_view > tokens ) {
+        std::vector< std::string_view > folded;
+        folded.reserve( tokens.size( ) );
+        for ( const auto token : tokens ) {
+            if ( !token.empty( ) )
+                folded.push_back( fold_token( token ) );
+        }
+
+        // token trigrams keep some order; a function shorter than one trigram is hashed as a whole
+        constexpr std::size_t                     k_shingle = 3;
+        std::array< int, 64 >                     weights { };
+        const std::span< const std::string_view > all( folded );
+
+        const auto add = [ & ]( std::span< const std::string_view > shingle ) {
+            const auto hash = feature_hash( shingle );
+            for ( int bit = 0; bit < 64; bit++ ) {
+                weights[ bit ] += ( hash >> bit ) & 1 ? 1 : -1;
+            }
+        };
+
+        if ( all.size( ) < k_shingle ) {
+            add( all );
+        } else {
+            for ( std::size_t i = 0; i + k_shingle <= all.size( ); i++ ) {
+                add( all.subspan( i, k_shingle ) );
+            }
+        }
+
+        std::uint64_t result = 0;
+        for ( int bit = 0; bit < 64; bit++ ) {
+            if ( weights[ bit ] > 0 )
+                result |= std::uint64_t { 1 } << bit;
+        }
+        return result;
+    }
+
+    bool c_similarity_index::open( const std::filesystem::path &path ) {
+        const std::lock_guard< std::mutex > lk( m_mutex );
+
+        if ( m_file ) {
+            std::fclose( m_file );
+            m_file = nullptr;
+        }
+
+        m_path = path;
+        m_entries.clear( );
+        m_slots.clear( );
+        for ( auto &buckets : m_buckets ) {
+            buckets.clear( );
+        }
+
+        std::size_t lines = 0;
+        {
+            std::ifstream f( m_path );
+            std::string   line;
+            while ( std::getline( f, line ) ) {
+                if ( line.empty( ) )
+                    continue;
+
+                lines++;
+                try {
+                    const auto record = json_t::parse( line );
+                    if ( record.value( "erased", false ) ) {
+                        remove( slot_key( record.at( "md5" ).get< std::string >( ), record.at( "addr" ).get< std::string >( ) ) );
+                        continue;
+                    }
+
+                    insert( { record.at( "md5" ).get< std::string >( ), record.at( "addr" ).get< std::string >( ),
+                              record.value( "name", "" ), record.at( "hash" ).get< std::uint64_t >( ) } );
+                } catch ( ... ) {
+                    // a line torn by a crash only loses that one function
+                }
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::create_directories( m_path.parent_path( ), ec );
+
+        if ( lines > m_entries.size( ) * k_rewrite_ratio )
+            return rewrite( );
+
+        IDA_RE_FOPEN( m_file, m_path.string( ).c_str( ), "ab" );
+        return m_file != nullptr;
+    }
+
+    void c_similarity_index::close( ) {
+        const std::lock_guard< std::mutex > lk( m_mutex );
+        if ( m_file ) {
+            std::fclose( m_file );
+            m_file = nullptr;
+        }
+    }
+
+    void c_similarity_index::add( std::string_view file_md5, std::string_view address, std::string_view name, std::uint64_t simhash ) {
+        similar_function_t entry { std::string( file_md5 ), std::string( address ), std::string( name ), simhash };
+
+        const std::lock_guard< std::mutex > lk( m_mutex );
+
+        // the index can always be rebuilt by analyzing again, so lines are flushed but not fsynced
+        if ( m_file ) {
+            const auto line = dump_line( entry );
+            std::fwrite( line.data( ), 1, line.size( ), m_file );
+            std::fflush( m_file );
+        }
+
+        insert( std::move( entry ) );
+    }
+
+    void c_similarity_index::erase( std::string_view file_md5, std::string_view address ) {
+        const std::lock_guard< std::mutex > lk( m_mutex );
+
+        const auto key = slot_key( file_md5, address );
+        if ( !m_slots.contains( key ) )
+            return;
+
+        if ( m_file ) {
+            const auto line = dump_erase_line( file_md5, address );
+            std::fwrite( line.data( ), 1, line.size( ), m_file );
+            std::fflush( m_file );
+        }
+
+        remove( key );
+    }
+
+    void c_similarity_index::clear( ) {
+        const std::lock_guard< std::mutex > lk( m_mutex );
+        m_entries.clear( );
+        m_slots.clear( );
+        for ( auto &buckets : m_buckets ) {
+            buckets.clear( );
+        }
+
+        if ( m_path.empty( ) )
+            return;
+
+        const bool reopen = m_file != nullptr;
+        if ( m_file ) {
+            std::fclose( m_file );
+            m_file = nullptr;
+        }
+
+        std::error_code ec;
+        std::filesystem::remove( m_path, ec );
+
+        if ( reopen )
+            IDA_RE_FOPEN( m_file, m_path.string( ).c_str( ), "ab" );
+    }
+
+    std::vector< similarity_match_t > c_similarity_index::query( std::uint64_t simhash, std::size_t limit, std::string_view file_md5,
+                                                                 std::string_view address, int max_distance ) const {
+        const std::lock_guard< std::mutex > lk( m_mutex );
+
+        // an entry sharing several bands with the query turns up in several buckets; compare it once
+        std::vector< std::uint32_t > candidates;
+        for ( int i = 0; i < k_bands; i++ ) {
+            const auto bucket = m_buckets[ i ].find( band( simhash, i ) );
+            if ( bucket != m_buckets[ i ].end( ) )
+                candidates.insert( candidates.end( ), bucket->second.begin( ), bucket->second.end( ) );
+        }
+        std::ranges::sort( candidates );
+        const auto duplicates = std::ranges::unique( candidates );
+        candidates.erase( duplicates.begin( ), duplicates.end( ) );
+
+        std::vector< std::pair< int, std::uint32_t > > matches;
+        for ( const auto index : candidates ) {
+            const auto &entry    = m_entries[ index ];
+            const int   distance = std::popcount( entry.m_simhash ^ simhash );
+            if ( distance > max_distance || ( entry.m_file_md5 == file_md5 && entry.m_address == address ) )
+                continue;
+
+            matches.emplace_back( distance, index );
+        }
+
+        const auto count = std::min( limit, matches.size( ) );
+        std::partial_sort( matches.begin( ), matches.begin( ) + static_cast< std::ptrdiff_t >( count ), matches.end( ) );
+
+        std::vector< similarity_match_t > results;
+        results.reserve( count );
+        for ( std::size_t i = 0; i < count; i++ ) {
+            results.push_back( { m_entries[ matches[ i ].second ], matches[ i ].first } );
+        }
+        return results;
+    }
+
+    std::size_t c_similarity_index::size( ) const {
+        const std::lock_guard< std::mutex > lk( m_mutex );
+        return m_entries.size( );
+    }
+
+    void c_similarity_index::insert( similar_function_t entry ) {
+        const auto [ slot, inserted ] = m_slots.try_emplace( slot_key( entry.m_file_md5, entry.m_address ),
+                                                             static_cast< std::uint32_t >( m_entries.size( ) ) );
+        const auto index              = slot->second;
+
+        if ( inserted ) {
+            m_entries.push_back( std::move( entry ) );
+        } else {
+            // re-analyzed after an edit: move the entry to the buckets of its new hash
+            auto      &existing = m_entries[ index ];
+            const bool moved    = existing.m_simhash != entry.m_simhash;
+            if ( moved ) {
+                for ( int i = 0; i < k_bands; i++ ) {
+                    std::erase( m_buckets[ i ][ band( existing.m_simhash, i ) ], index );
+                }
+            }
+
+            existing = std::move( entry );
+            if ( !moved )
+                return;
+        }
+
+        for ( int i = 0; i < k_bands; i++ ) {
+            m_buckets[ i ][ band( m_entries[ index ].m_simhash, i ) ].push_back( index );
+        }
+    }
+
+    void c_similarity_index::remove( std::string_view key ) {
+        const auto slot = m_slots.find( std::string( key ) );
+        if ( slot == m_slots.end( ) )
+            return;
+
+        const auto index = slot->second;
+        m_slots.erase( slot );
+        for ( int i = 0; i < k_bands; i++ ) {
+            std::erase( m_buckets[ i ][ band( m_entries[ index ].m_simhash, i ) ], index );
+        }
+
+        // fill the hole with the last entry so indices stay dense
+        const auto last = static_cast< std::uint32_t >( m_entries.size( ) - 1 );
+        if ( index != last ) {
+            auto &moved = m_entries[ last ];
+            for ( int i = 0; i < k_bands; i++ ) {
+                std::ranges::replace( m_buckets[ i ][ band( moved.m_simhash, i ) ], last, index );
+            }
+            m_slots[ slot_key( moved.m_file_md5, moved.m_address ) ] = index;
+            m_entries[ index ]                                       = std::move( moved );
+        }
+        m_entries.pop_back( );
+    }
+
+    bool c_similarity_index::rewrite( ) {
+        auto tmp_path  = m_path;
+        tmp_path      += ".tmp";
+
+        std::FILE *tmp = nullptr;
+        IDA_RE_FOPEN( tmp, tmp_path.string( ).c_str( ), "wb" );
+        if ( !tmp )
+            return false;
+
+        bool written = true;
+        for ( const auto &entry : m_entries ) {
+            const auto line = dump_line( entry );
+            written         = written && std::fwrite( line.data( ), 1, line.size( ), tmp ) == line.size( );
+        }
+        written = std::fclose( tmp ) == 0 && written;
+
+        std::error_code ec;
+        if ( written )
+            std::filesystem::rename( tmp_path, m_path, ec );
+        if ( !written || ec )
+            std::filesystem::remove( tmp_path, ec );
+
+        IDA_RE_FOPEN( m_file, m_path.string( ).c_str( ), "ab" );
+        return m_file != nullptr;
+    }
+} // namespace ida_re::utils
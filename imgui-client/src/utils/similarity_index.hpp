@@ -0,0 +1,81 @@
+#pragma once
+
+namespace ida_re::utils {
+    struct similar_function_t {
+        std::string   m_file_md5 { };
+        std::string   m_address { };
+        std::string   m_name { };
+        std::uint64_t m_simhash { 0 };
+    };
+
+    struct similarity_match_t {
+        similar_function_t m_function { };
+        int                m_distance { 0 }; // differing SimHash bits, 0..64
+    };
+
+    // Near-duplicate search over every function that was ever analyzed, in any binary.
+    //
+    // A function is reduced to a 64-bit SimHash of its token trigrams, so functions that share most of
+    // their code get hashes that differ in few bits. The hash is split into k_bands bands and the index
+    // keeps one bucket table per band: two hashes within k_bands - 1 bits of each other agree on at least
+    // one band, so query( ) only compares against the entries sharing a bucket with the query.
+    //
+    // Entries persist as JSON lines appended to one file; the last line for a function wins, and an
+    // "erased" line drops it.
+    // Thread-safe.
+    class c_similarity_index {
+      public:
+        static constexpr int k_bands        = 8;
+        static constexpr int k_max_distance = k_bands - 1; // every match up to here is guaranteed to be found
+
+        c_similarity_index( ) = default;
+        ~c_similarity_index( );
+
+        c_similarity_index( const c_similarity_index & )            = delete;
+        c_similarity_index &operator=( const c_similarity_index & ) = delete;
+
+        // SimHash of code tokens (c_syntax_highlighter::code_tokens). Auto-generated names, local variable
+        // numbers and long constants are folded first, so variants built at other addresses still match.
+        [[nodiscard]] static std::uint64_t simhash( std::span< const std::string_view > tokens );
+
+        // Loads the index at path and keeps the file open for appends
+        bool open( const std::filesystem::path &path );
+        void close( );
+
+        // adds or replaces the entry for file_md5/address
+        void add( std::string_view file_md5, std::string_view address, std::string_view name, std::uint64_t simhash );
+
+        // drops the entry for file_md5/address, if any
+        void erase( std::string_view file_md5, std::string_view address );
+
+        // drops everything and deletes the file
+        void clear( );
+
+        // Up to limit entries within max_distance of simhash, closest first; file_md5/address itself is skipped
+        [[nodiscard]] std::vector< similarity_match_t > query( std::uint64_t simhash, std::size_t limit, std::string_view file_md5 = { },
+                                                               std::string_view address = { }, int max_distance = k_max_distance ) const;
+
+        [[nodiscard]] std::size_t size( ) const;
+
+      private:
+        static constexpr int k_band_bits = 64 / k_bands;
+
+        // an index file with more than this many lines per entry is rewritten on open( )
+        static constexpr std::size_t k_rewrite_ratio = 2;
+
+        [[nodiscard]] static std::uint64_t band( std::uint64_t simhash, int index ) noexcept {
+            return ( simhash >> ( index * k_band_bits ) ) & ( ( std::uint64_t { 1 } << k_band_bits ) - 1 );
+        }
+
+        void insert( similar_function_t entry ); // m_mutex held
+        void remove( std::string_view key );     // m_mutex held
+        bool rewrite( );                         // m_mutex held
+
+        mutable std::mutex                                                                       m_mutex { };
+        std::vector< similar_function_t >                                                        m_entries { };
+        std::unordered_map< std::string, std::uint32_t >                                         m_slots { }; // file_md5/address -> entry
+        std::array< std::unordered_map< std::uint64_t, std::vector< std::uint32_t > >, k_bands > m_buckets { };
+        std::filesystem::path                                                                    m_path { };
+        std::FILE                                                                               *m_file { nullptr };
+    };
+} // namespace ida_re::utils
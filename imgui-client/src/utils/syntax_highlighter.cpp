@@ -1,24 +1,14 @@
 #include "vendor.hpp"
 
 #include "syntax_highlighter.hpp"
+#include "word_classifier.hpp"
 
 namespace ida_re::utils {
     c_syntax_highlighter::c_syntax_highlighter( ) {
-        // C/C++ keywords
-        m_keywords = { "if",       "else",      "while",  "for",      "do",       "switch",  "case",     "default", "break",     "continue",
-                       "return",   "goto",      "struct", "union",    "enum",     "typedef", "sizeof",   "const",   "volatile",  "static",
-                       "extern",   "register",  "auto",   "inline",   "restrict", "class",   "public",   "private", "protected", "virtual",
-                       "override", "namespace", "using",  "template", "typename", "new",     "delete",   "this",    "nullptr",   "true",
-                       "false",    "try",       "catch",  "throw",    "operator", "friend",  "explicit", "mutable", "constexpr" };
-
-        // C/C++ types
-        m_types = { "void",     "int",       "char",     "short",     "long",   "float",   "double",  "unsigned", "signed",
-                    "bool",     "wchar_t",   "size_t",   "ptrdiff_t", "int8_t", "int16_t", "int32_t", "int64_t",  "uint8_t",
-                    "uint16_t", "uint32_t",  "uint64_t", "BYTE",      "WORD",   "DWORD",   "QWORD",   "BOOL",     "HANDLE",
-                    "HWND",     "HINSTANCE", "LPVOID",   "LPCSTR",    "LPSTR",  "LPCWSTR", "LPWSTR" };
-
         // Default to iOS dark theme
         m_colors = ios_dark_theme( );
+
+        m_documents.reserve( k_max_cached_documents );
     }
 
     c_syntax_highlighter::color_scheme_t c_syntax_highlighter::ios_dark_theme( ) {
@@ -66,15 +56,7 @@ namespace ida_re::utils {
         };
     }
 
-    bool c_syntax_highlighter::is_keyword( std::string_view word ) {
-        return m_keywords.find( std::string( word ) ) != m_keywords.end( );
-    }
-
-    bool c_syntax_highlighter::is_type( std::string_view word ) {
-        return m_types.find( std::string( word ) ) != m_types.end( );
-    }
-
-    bool c_syntax_highlighter::is_number( std::string_view word ) {
+    bool c_syntax_highlighter::is_number( std::string_view word ) const {
         if ( word.empty( ) )
             return false;
 
@@ -99,23 +81,47 @@ namespace ida_re::utils {
         return has_digit;
     }
 
-    std::vector< c_syntax_highlighter::token_t > c_syntax_highlighter::tokenize_line( std::string_view line ) {
-        std::vector< token_t > tokens;
-        size_t                 i = 0;
+    void c_syntax_highlighter::tokenize_line( std::string_view text, std::uint32_t line_offset, std::uint32_t line_length,
+                                              std::vector< token_span_t > &tokens ) const {
+        const std::string_view line        = text.substr( line_offset, line_length );
+        const std::size_t      first_token = tokens.size( );
+
+        // adjacent plain runs (whitespace, operators) merge into one span so they draw as one item
+        const auto push = [ & ]( e_token_type type, std::size_t start, std::size_t end ) {
+            const auto offset = line_offset + static_cast< std::uint32_t >( start );
+            const auto length = static_cast< std::uint32_t >( end - start );
+
+            if ( type == e_token_type::e_default && tokens.size( ) > first_token ) {
+                auto &last = tokens.back( );
+                if ( last.m_type == e_token_type::e_default && last.m_offset + last.m_length == offset ) {
+                    last.m_length += length;
+                    return;
+                }
+            }
+
+            tokens.push_back( { offset, length, type } );
+        };
+
+        const auto is_space  = []( char c ) { return std::isspace( static_cast< unsigned char >( c ) ) != 0; };
+        const auto is_digit  = []( char c ) { return std::isdigit( static_cast< unsigned char >( c ) ) != 0; };
+        const auto is_xdigit = []( char c ) { return std::isxdigit( static_cast< unsigned char >( c ) ) != 0; };
+        const auto is_ident  = []( char c ) { return std::isalnum( static_cast< unsigned char >( c ) ) != 0 || c == '_'; };
+
+        size_t i = 0;
 
         while ( i < line.size( ) ) {
             // Skip whitespace but preserve it
-            if ( std::isspace( line[ i ] ) ) {
+            if ( is_space( line[ i ] ) ) {
                 size_t start = i;
-                while ( i < line.size( ) && std::isspace( line[ i ] ) )
+                while ( i < line.size( ) && is_space( line[ i ] ) )
                     i++;
-                tokens.push_back( { e_token_type::e_default, std::string( line.substr( start, i - start ) ) } );
+                push( e_token_type::e_default, start, i );
                 continue;
             }
 
             // Comments
             if ( i + 1 < line.size( ) && line[ i ] == '/' && line[ i + 1 ] == '/' ) {
-                tokens.push_back( { e_token_type::e_comment, std::string( line.substr( i ) ) } );
+                push( e_token_type::e_comment, i, line.size( ) );
                 break;
             }
 
@@ -124,15 +130,14 @@ namespace ida_re::utils {
                 i            += 2;
                 while ( i + 1 < line.size( ) && !( line[ i ] == '*' && line[ i + 1 ] == '/' ) )
                     i++;
-                if ( i + 1 < line.size( ) )
-                    i += 2;
-                tokens.push_back( { e_token_type::e_comment, std::string( line.substr( start, i - start ) ) } );
+                i = i + 1 < line.size( ) ? i + 2 : line.size( );
+                push( e_token_type::e_comment, start, i );
                 continue;
             }
 
             // Preprocessor
             if ( line[ i ] == '#' ) {
-                tokens.push_back( { e_token_type::e_preprocessor, std::string( line.substr( i ) ) } );
+                push( e_token_type::e_preprocessor, i, line.size( ) );
                 break;
             }
 
@@ -148,225 +153,337 @@ namespace ida_re::utils {
                 }
                 if ( i < line.size( ) )
                     i++;
-                tokens.push_back( { e_token_type::e_string, std::string( line.substr( start, i - start ) ) } );
+                push( e_token_type::e_string, start, i );
                 continue;
             }
 
             // Identifiers and keywords
-            if ( std::isalpha( line[ i ] ) || line[ i ] == '_' ) {
+            if ( std::isalpha( static_cast< unsigned char >( line[ i ] ) ) || line[ i ] == '_' ) {
                 size_t start = i;
-                while ( i < line.size( ) && ( std::isalnum( line[ i ] ) || line[ i ] == '_' ) )
+                while ( i < line.size( ) && is_ident( line[ i ] ) )
                     i++;
-                std::string word = std::string( line.substr( start, i - start ) );
+                const std::string_view word = line.substr( start, i - start );
 
-                e_token_type type = e_token_type::e_default;
-                if ( is_keyword( word ) ) {
+                const auto   word_class = classify_word( word );
+                e_token_type type       = e_token_type::e_default;
+                if ( word_class == e_word_class::e_keyword ) {
                     type = e_token_type::e_keyword;
-                } else if ( is_type( word ) ) {
+                } else if ( word_class == e_word_class::e_type ) {
                     type = e_token_type::e_type;
                 } else {
                     // Check if followed by '(' - likely a function
                     size_t j = i;
-                    while ( j < line.size( ) && std::isspace( line[ j ] ) )
+                    while ( j < line.size( ) && is_space( line[ j ] ) )
                         j++;
                     if ( j < line.size( ) && line[ j ] == '(' ) {
                         type = e_token_type::e_function;
                     }
                 }
 
-                tokens.push_back( { type, word } );
+                push( type, start, i );
                 continue;
             }
 
             // Numbers
-            if ( std::isdigit( line[ i ] )
-                 || ( line[ i ] == '0' && i + 1 < line.size( ) && ( line[ i + 1 ] == 'x' || line[ i + 1 ] == 'X' ) ) ) {
+            if ( is_digit( line[ i ] ) ) {
                 size_t start = i;
                 if ( line[ i ] == '0' && i + 1 < line.size( ) && ( line[ i + 1 ] == 'x' || line[ i + 1 ] == 'X' ) ) {
                     i += 2;
-                    while ( i < line.size( ) && std::isxdigit( line[ i ] ) )
+                    while ( i < line.size( ) && is_xdigit( line[ i ] ) )
                         i++;
                 } else {
-                    while ( i < line.size( ) && ( std::isdigit( line[ i ] ) || line[ i ] == '.' ) )
+                    while ( i < line.size( ) && ( is_digit( line[ i ] ) || line[ i ] == '.' ) )
                         i++;
                     if ( i < line.size( ) && ( line[ i ] == 'f' || line[ i ] == 'F' || line[ i ] == 'l' || line[ i ] == 'L' ) )
                         i++;
                 }
-                tokens.push_back( { e_token_type::e_number, std::string( line.substr( start, i - start ) ) } );
+                push( e_token_type::e_number, start, i );
                 continue;
             }
 
             // Other characters (operators, punctuation)
-            tokens.push_back( { e_token_type::e_default, std::string( 1, line[ i ] ) } );
+            push( e_token_type::e_default, i, i + 1 );
             i++;
         }
-
-        return tokens;
     }
 
-    void c_syntax_highlighter::render_text( const std::string &text, bool show_line_numbers ) {
-        std::istringstream stream( text );
-        std::string        line;
-        int                line_num = 1;
+    std::vector< std::string_view > c_syntax_highlighter::code_tokens( std::string_view text ) const {
+        std::vector< std::string_view > out;
+        std::vector< token_span_t >     tokens;
 
-        ImGui::PushStyleVar( ImGuiStyleVar_ItemSpacing, ImVec2( 0, 0 ) );
+        const auto is_ident = []( char c ) { return std::isalnum( static_cast< unsigned char >( c ) ) != 0 || c == '_'; };
 
-        while ( std::getline( stream, line ) ) {
-            if ( show_line_numbers ) {
-                // Draw line number background
-                ImVec2      pos         = ImGui::GetCursorScreenPos( );
-                ImDrawList *draw_list   = ImGui::GetWindowDrawList( );
-                float       line_height = ImGui::GetTextLineHeight( );
-
-                char num_str[ 8 ];
-                snprintf( num_str, sizeof( num_str ), "%4d", line_num );
-
-                float num_width = ImGui::CalcTextSize( num_str ).x + 16;
-                draw_list->AddRectFilled( pos, ImVec2( pos.x + num_width, pos.y + line_height ),
-                                          ImGui::GetColorU32( m_colors.line_number_bg ) );
-
-                // Draw line number
-                ImGui::TextColored( m_colors.line_number, "%s", num_str );
-                ImGui::SameLine( );
-                ImGui::Text( "  " );
-                ImGui::SameLine( );
-            }
+        for ( std::size_t offset = 0; offset < text.size( ); ) {
+            const auto newline = std::min( text.find( '\n', offset ), text.size( ) );
+
+            tokens.clear( );
+            tokenize_line( text, static_cast< std::uint32_t >( offset ), static_cast< std::uint32_t >( newline - offset ), tokens );
+            offset = newline + 1;
 
-            // Tokenize and render line
-            auto tokens = tokenize_line( line );
             for ( const auto &token : tokens ) {
-                ImVec4 color;
-                switch ( token.m_type ) {
-                    case e_token_type::e_keyword :
-                        color = m_colors.keyword;
-                        break;
-                    case e_token_type::e_type :
-                        color = m_colors.type;
-                        break;
-                    case e_token_type::e_comment :
-                        color = m_colors.comment;
-                        break;
-                    case e_token_type::e_string :
-                        color = m_colors.string;
-                        break;
-                    case e_token_type::e_number :
-                        color = m_colors.number;
-                        break;
-                    case e_token_type::e_preprocessor :
-                        color = m_colors.preprocessor;
-                        break;
-                    case e_token_type::e_function :
-                        color = m_colors.function;
-                        break;
-                    default :
-                        color = m_colors.text_default;
-                        break;
+                const auto span = text.substr( token.m_offset, token.m_length );
+                if ( token.m_type == e_token_type::e_comment )
+                    continue;
+
+                if ( token.m_type != e_token_type::e_default ) {
+                    out.push_back( span );
+                    continue;
+                }
+
+                // plain runs hold whitespace, operators and ordinary identifiers merged together
+                for ( std::size_t i = 0; i < span.size( ); ) {
+                    if ( std::isspace( static_cast< unsigned char >( span[ i ] ) ) ) {
+                        i++;
+                    } else if ( is_ident( span[ i ] ) ) {
+                        const auto start = i;
+                        while ( i < span.size( ) && is_ident( span[ i ] ) )
+                            i++;
+                        out.push_back( span.substr( start, i - start ) );
+                    } else {
+                        out.push_back( span.substr( i++, 1 ) );
+                    }
                 }
+            }
+        }
+        return out;
+    }
+
+    const c_syntax_highlighter::document_t &c_syntax_highlighter::get_document( std::string_view text, bool tokenize,
+                                                                                 std::uint64_t version ) {
+        m_use_counter++;
+
+        // the same buffer at the same version is unchanged, so the views stay O(visible lines);
+        // otherwise only an identical text is a hit
+        for ( auto &document : m_documents ) {
+            if ( document.m_tokenized != tokenize || document.m_text.size( ) != text.size( ) )
+                continue;
 
-                ImGui::TextColored( color, "%s", token.m_text.c_str( ) );
-                ImGui::SameLine( );
+            const bool same_version = version != 0 && document.m_version == version && document.m_source == text.data( );
+            if ( same_version || document.m_text == text ) {
+                document.m_source    = text.data( );
+                document.m_version   = version;
+                document.m_last_used = m_use_counter;
+                return document;
             }
+        }
+
+        // reuse the least recently drawn slot once the cache is full
+        document_t *document = nullptr;
+        if ( m_documents.size( ) < k_max_cached_documents ) {
+            document = &m_documents.emplace_back( );
+        } else {
+            document = &*std::ranges::min_element( m_documents, { }, &document_t::m_last_used );
+        }
+
+        document->m_source    = text.data( );
+        document->m_version   = version;
+        document->m_tokenized = tokenize;
+        document->m_last_used = m_use_counter;
+        document->m_text.assign( text );
+        document->m_tokens.clear( );
+        document->m_lines.clear( );
+
+        // same line split as std::getline: a trailing newline does not start an extra empty line
+        const auto    size   = static_cast< std::uint32_t >( text.size( ) );
+        std::uint32_t offset = 0;
+        while ( offset < size ) {
+            const auto newline = text.find( '\n', offset );
+            const auto end     = newline == std::string_view::npos ? size : static_cast< std::uint32_t >( newline );
+
+            auto length = end - offset;
+            if ( length > 0 && text[ end - 1 ] == '\r' )
+                length--;
+
+            line_span_t line { offset, length, static_cast< std::uint32_t >( document->m_tokens.size( ) ), 0 };
+            if ( tokenize )
+                tokenize_line( document->m_text, offset, length, document->m_tokens );
+            line.m_token_count = static_cast< std::uint32_t >( document->m_tokens.size( ) ) - line.m_first_token;
+            document->m_lines.push_back( line );
+
+            offset = end + 1;
+        }
+
+        return *document;
+    }
 
-            ImGui::NewLine( );
-            line_num++;
+    const ImVec4 &c_syntax_highlighter::token_color( e_token_type type ) const noexcept {
+        switch ( type ) {
+            case e_token_type::e_keyword :
+                return m_colors.keyword;
+            case e_token_type::e_type :
+                return m_colors.type;
+            case e_token_type::e_comment :
+                return m_colors.comment;
+            case e_token_type::e_string :
+                return m_colors.string;
+            case e_token_type::e_number :
+                return m_colors.number;
+            case e_token_type::e_preprocessor :
+                return m_colors.preprocessor;
+            case e_token_type::e_function :
+                return m_colors.function;
+            default :
+                return m_colors.text_default;
         }
+    }
+
+    void c_syntax_highlighter::render_text( const std::string &text, bool show_line_numbers, std::uint64_t version ) {
+        const auto &document = get_document( text, true, version );
+        const char *buffer   = document.m_text.data( );
+
+        ImGui::PushStyleVar( ImGuiStyleVar_ItemSpacing, ImVec2( 0, 0 ) );
+
+        // only lines inside the scroll region are submitted; the clipper skips over the rest
+        ImGuiListClipper clipper;
+        clipper.Begin( static_cast< int >( document.m_lines.size( ) ) );
+        while ( clipper.Step( ) ) {
+            for ( int line_index = clipper.DisplayStart; line_index < clipper.DisplayEnd; line_index++ ) {
+                const auto &line = document.m_lines[ line_index ];
+
+                if ( show_line_numbers ) {
+                    // Draw line number background
+                    ImVec2      pos         = ImGui::GetCursorScreenPos( );
+                    ImDrawList *draw_list   = ImGui::GetWindowDrawList( );
+                    float       line_height = ImGui::GetTextLineHeight( );
+
+                    char num_str[ 16 ];
+                    snprintf( num_str, sizeof( num_str ), "%4d", line_index + 1 );
+
+                    float num_width = ImGui::CalcTextSize( num_str ).x + 16;
+                    draw_list->AddRectFilled( pos, ImVec2( pos.x + num_width, pos.y + line_height ),
+                                              ImGui::GetColorU32( m_colors.line_number_bg ) );
+
+                    // Draw line number
+                    ImGui::TextColored( m_colors.line_number, "%s", num_str );
+                    ImGui::SameLine( );
+                    ImGui::TextUnformatted( "  " );
+                    ImGui::SameLine( );
+                }
+
+                // Walk the cached spans; nothing is tokenized or allocated here
+                for ( std::uint32_t t = line.m_first_token; t < line.m_first_token + line.m_token_count; t++ ) {
+                    const auto &token = document.m_tokens[ t ];
+
+                    ImGui::PushStyleColor( ImGuiCol_Text, token_color( token.m_type ) );
+                    ImGui::TextUnformatted( buffer + token.m_offset, buffer + token.m_offset + token.m_length );
+                    ImGui::PopStyleColor( );
+                    ImGui::SameLine( );
+                }
+
+                ImGui::NewLine( );
+            }
+        }
+        clipper.End( );
 
         ImGui::PopStyleVar( );
     }
 
-    void c_syntax_highlighter::render_assembly( const std::string &text, bool show_line_numbers ) {
-        std::istringstream stream( text );
-        std::string        line;
-        int                line_num = 1;
+    void c_syntax_highlighter::render_assembly( const std::string &text, bool show_line_numbers, std::uint64_t version ) {
+        const auto &document = get_document( text, false, version );
+        const auto  buffer   = std::string_view( document.m_text );
 
         ImGui::PushStyleVar( ImGuiStyleVar_ItemSpacing, ImVec2( 0, 2 ) );
         ImGui::PushFont( ImGui::GetIO( ).Fonts->Fonts[ 0 ] ); // Use monospace font
 
-        while ( std::getline( stream, line ) ) {
-            if ( show_line_numbers ) {
-                ImGui::TextColored( m_colors.line_number, "%4d", line_num );
-                ImGui::SameLine( );
-            }
-
-            // Check for comment
-            size_t      comment_pos  = line.find( ';' );
-            std::string code_part    = ( comment_pos != std::string::npos ) ? line.substr( 0, comment_pos ) : line;
-            std::string comment_part = ( comment_pos != std::string::npos ) ? line.substr( comment_pos ) : "";
-
-            // Render leading whitespace
-            size_t first_non_space = code_part.find_first_not_of( " \t" );
-            if ( first_non_space != std::string::npos && first_non_space > 0 ) {
-                std::string spaces = code_part.substr( 0, first_non_space );
-                ImGui::TextUnformatted( spaces.c_str( ), spaces.c_str( ) + spaces.size( ) );
-                ImGui::SameLine( );
-                code_part = code_part.substr( first_non_space );
-            }
+        ImGuiListClipper clipper;
+        clipper.Begin( static_cast< int >( document.m_lines.size( ) ) );
+        while ( clipper.Step( ) ) {
+            for ( int line_index = clipper.DisplayStart; line_index < clipper.DisplayEnd; line_index++ ) {
+                const auto &line = document.m_lines[ line_index ];
 
-            // Parse code part manually to preserve spacing
-            size_t pos        = 0;
-            bool   first_word = true;
-
-            while ( pos < code_part.size( ) ) {
-                // Skip spaces
-                size_t word_start = code_part.find_first_not_of( " \t,", pos );
-                if ( word_start == std::string::npos )
-                    break;
-
-                // Find word end
-                size_t word_end = code_part.find_first_of( " \t,;", word_start );
-                if ( word_end == std::string::npos )
-                    word_end = code_part.size( );
-
-                std::string word  = code_part.substr( word_start, word_end - word_start );
-                ImVec4      color = m_colors.text_default;
-
-                if ( first_word ) {
-                    color      = m_colors.keyword;
-                    first_word = false;
-                } else if ( word.find( "0x" ) == 0 || word.find( "0X" ) == 0 ) {
-                    color = m_colors.number;
-                } else if ( word.find( '[' ) != std::string::npos || word.find( ']' ) != std::string::npos ) {
-                    color = m_colors.type;
-                } else if ( word.find( "ptr" ) != std::string::npos ) {
-                    color = m_colors.type;
-                } else if ( !word.empty( )
-                            && ( word[ 0 ] == 'r' || word[ 0 ] == 'e' || word.find( "sp" ) != std::string::npos
-                                 || word.find( "bp" ) != std::string::npos ) ) {
-                    color = ImVec4( 0.8f, 0.6f, 0.9f, 1.0f );
+                if ( show_line_numbers ) {
+                    ImGui::TextColored( m_colors.line_number, "%4d", line_index + 1 );
+                    ImGui::SameLine( );
                 }
 
-                ImGui::TextColored( color, "%s", word.c_str( ) );
-                ImGui::SameLine( );
-
-                // Render spacing/punctuation between words
-                if ( word_end < code_part.size( ) ) {
-                    size_t punct_end = code_part.find_first_not_of( " \t,", word_end );
-                    if ( punct_end == std::string::npos )
-                        punct_end = code_part.size( );
-                    std::string spacing = code_part.substr( word_end, punct_end - word_end );
-                    if ( !spacing.empty( ) ) {
-                        ImGui::TextUnformatted( spacing.c_str( ), spacing.c_str( ) + spacing.size( ) );
-                        ImGui::SameLine( );
-                    }
-                    pos = punct_end;
-                } else {
-                    pos = word_end;
-                }
-            }
+                render_assembly_line( buffer.substr( line.m_offset, line.m_length ) );
 
-            // Render comment
-            if ( !comment_part.empty( ) ) {
-                ImGui::TextColored( m_colors.comment, "%s", comment_part.c_str( ) );
+                ImGui::NewLine( );
             }
-
-            ImGui::NewLine( );
-            line_num++;
         }
+        clipper.End( );
 
         ImGui::PopFont( );
         ImGui::PopStyleVar( );
     }
 
+    void c_syntax_highlighter::render_assembly_line( std::string_view line ) {
+        const auto draw = []( std::string_view part, const ImVec4 &color ) {
+            ImGui::PushStyleColor( ImGuiCol_Text, color );
+            ImGui::TextUnformatted( part.data( ), part.data( ) + part.size( ) );
+            ImGui::PopStyleColor( );
+            ImGui::SameLine( );
+        };
+
+        // Check for comment
+        size_t           comment_pos  = line.find( ';' );
+        std::string_view code_part    = line.substr( 0, comment_pos );
+        std::string_view comment_part = comment_pos != std::string_view::npos ? line.substr( comment_pos ) : std::string_view { };
+
+        // Render leading whitespace
+        size_t first_non_space = code_part.find_first_not_of( " \t" );
+        if ( first_non_space != std::string_view::npos && first_non_space > 0 ) {
+            ImGui::TextUnformatted( code_part.data( ), code_part.data( ) + first_non_space );
+            ImGui::SameLine( );
+            code_part = code_part.substr( first_non_space );
+        }
+
+        // Parse code part manually to preserve spacing
+        size_t pos        = 0;
+        bool   first_word = true;
+
+        while ( pos < code_part.size( ) ) {
+            // Skip spaces
+            size_t word_start = code_part.find_first_not_of( " \t,", pos );
+            if ( word_start == std::string_view::npos )
+                break;
+
+            // Find word end
+            size_t word_end = code_part.find_first_of( " \t,;", word_start );
+            if ( word_end == std::string_view::npos )
+                word_end = code_part.size( );
+
+            std::string_view word  = code_part.substr( word_start, word_end - word_start );
+            ImVec4           color = m_colors.text_default;
+
+            if ( first_word ) {
+                color      = m_colors.keyword;
+                first_word = false;
+            } else if ( word.starts_with( "0x" ) || word.starts_with( "0X" ) ) {
+                color = m_colors.number;
+            } else if ( word.find( '[' ) != std::string_view::npos || word.find( ']' ) != std::string_view::npos ) {
+                color = m_colors.type;
+            } else if ( word.find( "ptr" ) != std::string_view::npos ) {
+                color = m_colors.type;
+            } else if ( !word.empty( )
+                        && ( word[ 0 ] == 'r' || word[ 0 ] == 'e' || word.find( "sp" ) != std::string_view::npos
+                             || word.find( "bp" ) != std::string_view::npos ) ) {
+                color = ImVec4( 0.8f, 0.6f, 0.9f, 1.0f );
+            }
+
+            draw( word, color );
+
+            // Render spacing/punctuation between words
+            if ( word_end < code_part.size( ) ) {
+                size_t punct_end = code_part.find_first_not_of( " \t,", word_end );
+                if ( punct_end == std::string_view::npos )
+                    punct_end = code_part.size( );
+                if ( punct_end > word_end ) {
+                    ImGui::TextUnformatted( code_part.data( ) + word_end, code_part.data( ) + punct_end );
+                    ImGui::SameLine( );
+                }
+                pos = punct_end;
+            } else {
+                pos = word_end;
+            }
+        }
+
+        // Render comment
+        if ( !comment_part.empty( ) ) {
+            draw( comment_part, m_colors.comment );
+        }
+    }
+
     void c_syntax_highlighter::render_markdown( const std::string &text ) {
         std::istringstream stream( text );
         std::string        line;
@@ -7,9 +7,10 @@ namespace ida_re::utils {
       public:
         c_syntax_highlighter( );
 
-        // Render text with syntax highlighting
-        void render_text( const std::string &text, bool show_line_numbers = true );
-        void render_assembly( const std::string &text, bool show_line_numbers = true );
+        // Render text with syntax highlighting. A caller that bumps version whenever text changes lets its
+        // document be found without comparing the text; version 0 compares it every frame.
+        void render_text( const std::string &text, bool show_line_numbers = true, std::uint64_t version = 0 );
+        void render_assembly( const std::string &text, bool show_line_numbers = true, std::uint64_t version = 0 );
         void render_markdown( const std::string &text );
 
         // Color scheme
@@ -48,8 +49,12 @@ namespace ida_re::utils {
             return m_dark_mode;
         }
 
+        // The C tokens tokenize_line( ) finds in text, as views into it: comments and whitespace are dropped and
+        // plain runs are split into words and single punctuation characters. Touches no render state.
+        [[nodiscard]] std::vector< std::string_view > code_tokens( std::string_view text ) const;
+
       private:
-        enum class e_token_type {
+        enum class e_token_type : std::uint8_t {
             e_default,
             e_keyword,
             e_type,
@@ -60,20 +65,46 @@ namespace ida_re::utils {
             e_function
         };
 
-        struct token_t {
-            e_token_type m_type { };
-            std::string  m_text { };
+        // a token is a span into its document's text buffer, so tokenizing allocates nothing per token
+        struct token_span_t {
+            std::uint32_t m_offset { 0 };
+            std::uint32_t m_length { 0 };
+            e_token_type  m_type { };
+        };
+
+        struct line_span_t {
+            std::uint32_t m_offset { 0 };
+            std::uint32_t m_length { 0 };
+            std::uint32_t m_first_token { 0 };
+            std::uint32_t m_token_count { 0 };
         };
 
-        std::vector< token_t > tokenize_line( std::string_view line );
-        bool                   is_keyword( std::string_view word );
-        bool                   is_type( std::string_view word );
-        bool                   is_number( std::string_view word );
+        // text split (and, for C, tokenized) once and reused every frame until it changes.
+        // the line table is what lets the views clip to the visible rows
+        struct document_t {
+            const char                 *m_source { nullptr }; // caller's buffer, with the version it passed
+            std::uint64_t               m_version { 0 };
+            bool                        m_tokenized { false };
+            std::string                 m_text { };
+            std::vector< token_span_t > m_tokens { };
+            std::vector< line_span_t >  m_lines { };
+            std::uint64_t               m_last_used { 0 };
+        };
+
+        // pseudocode, both diff panes and a few chat code blocks are usually on screen at once
+        static constexpr std::size_t k_max_cached_documents = 16;
+
+        const document_t &get_document( std::string_view text, bool tokenize, std::uint64_t version );
+        void              render_assembly_line( std::string_view line );
+        void              tokenize_line( std::string_view text, std::uint32_t line_offset, std::uint32_t line_length,
+                                         std::vector< token_span_t > &tokens ) const;
+        const ImVec4     &token_color( e_token_type type ) const noexcept;
+        bool              is_number( std::string_view word ) const;
 
-        color_scheme_t                    m_colors { };
-        std::unordered_set< std::string > m_keywords { };
-        std::unordered_set< std::string > m_types { };
-        bool                              m_dark_mode { true };
+        color_scheme_t            m_colors { };
+        bool                      m_dark_mode { true };
+        std::vector< document_t > m_documents { };
+        std::uint64_t             m_use_counter { 0 };
     };
 
 } // namespace ida_re::utils
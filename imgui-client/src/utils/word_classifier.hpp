@@ -0,0 +1,258 @@
+#pragma once
+
+namespace ida_re::utils {
+    enum class e_word_class : std::uint8_t {
+        e_none,
+        e_keyword,
+        e_type
+    };
+
+    namespace detail {
+        struct classified_word_t {
+            std::string_view m_word { };
+            e_word_class     m_class { };
+        };
+
+        // Add new words here; the lookup table below is regenerated at compile time
+        inline constexpr classified_word_t k_classified_words[] = {
+            // C/C++ keywords
+            { "if", e_word_class::e_keyword },
+            { "else", e_word_class::e_keyword },
+            { "while", e_word_class::e_keyword },
+            { "for", e_word_class::e_keyword },
+            { "do", e_word_class::e_keyword },
+            { "switch", e_word_class::e_keyword },
+            { "case", e_word_class::e_keyword },
+            { "default", e_word_class::e_keyword },
+            { "break", e_word_class::e_keyword },
+            { "continue", e_word_class::e_keyword },
+            { "return", e_word_class::e_keyword },
+            { "goto", e_word_class::e_keyword },
+            { "struct", e_word_class::e_keyword },
+            { "union", e_word_class::e_keyword },
+            { "enum", e_word_class::e_keyword },
+            { "typedef", e_word_class::e_keyword },
+            { "sizeof", e_word_class::e_keyword },
+            { "const", e_word_class::e_keyword },
+            { "volatile", e_word_class::e_keyword },
+            { "static", e_word_class::e_keyword },
+            { "extern", e_word_class::e_keyword },
+            { "register", e_word_class::e_keyword },
+            { "auto", e_word_class::e_keyword },
+            { "inline", e_word_class::e_keyword },
+            { "restrict", e_word_class::e_keyword },
+            { "class", e_word_class::e_keyword },
+            { "public", e_word_class::e_keyword },
+            { "private", e_word_class::e_keyword },
+            { "protected", e_word_class::e_keyword },
+            { "virtual", e_word_class::e_keyword },
+            { "override", e_word_class::e_keyword },
+            { "namespace", e_word_class::e_keyword },
+            { "using", e_word_class::e_keyword },
+            { "template", e_word_class::e_keyword },
+            { "typename", e_word_class::e_keyword },
+            { "new", e_word_class::e_keyword },
+            { "delete", e_word_class::e_keyword },
+            { "this", e_word_class::e_keyword },
+            { "nullptr", e_word_class::e_keyword },
+            { "true", e_word_class::e_keyword },
+            { "false", e_word_class::e_keyword },
+            { "try", e_word_class::e_keyword },
+            { "catch", e_word_class::e_keyword },
+            { "throw", e_word_class::e_keyword },
+            { "operator", e_word_class::e_keyword },
+            { "friend", e_word_class::e_keyword },
+            { "explicit", e_word_class::e_keyword },
+            { "mutable", e_word_class::e_keyword },
+            { "constexpr", e_word_class::e_keyword },
+
+            // Hex-Rays calling conventions and attributes
+            { "__cdecl", e_word_class::e_keyword },
+            { "__stdcall", e_word_class::e_keyword },
+            { "__fastcall", e_word_class::e_keyword },
+            { "__thiscall", e_word_class::e_keyword },
+            { "__usercall", e_word_class::e_keyword },
+            { "__userpurge", e_word_class::e_keyword },
+            { "__noreturn", e_word_class::e_keyword },
+            { "__spoils", e_word_class::e_keyword },
+            { "__unaligned", e_word_class::e_keyword },
+            { "__ptr32", e_word_class::e_keyword },
+            { "__ptr64", e_word_class::e_keyword },
+
+            // C/C++ types
+            { "void", e_word_class::e_type },
+            { "int", e_word_class::e_type },
+            { "char", e_word_class::e_type },
+            { "short", e_word_class::e_type },
+            { "long", e_word_class::e_type },
+            { "float", e_word_class::e_type },
+            { "double", e_word_class::e_type },
+            { "unsigned", e_word_class::e_type },
+            { "signed", e_word_class::e_type },
+            { "bool", e_word_class::e_type },
+            { "wchar_t", e_word_class::e_type },
+            { "size_t", e_word_class::e_type },
+            { "ptrdiff_t", e_word_class::e_type },
+            { "intptr_t", e_word_class::e_type },
+            { "uintptr_t", e_word_class::e_type },
+            { "int8_t", e_word_class::e_type },
+            { "int16_t", e_word_class::e_type },
+            { "int32_t", e_word_class::e_type },
+            { "int64_t", e_word_class::e_type },
+            { "uint8_t", e_word_class::e_type },
+            { "uint16_t", e_word_class::e_type },
+            { "uint32_t", e_word_class::e_type },
+            { "uint64_t", e_word_class::e_type },
+            { "va_list", e_word_class::e_type },
+
+            // Hex-Rays types
+            { "_BYTE", e_word_class::e_type },
+            { "_WORD", e_word_class::e_type },
+            { "_DWORD", e_word_class::e_type },
+            { "_QWORD", e_word_class::e_type },
+            { "_OWORD", e_word_class::e_type },
+            { "_TBYTE", e_word_class::e_type },
+            { "_BOOL1", e_word_class::e_type },
+            { "_BOOL2", e_word_class::e_type },
+            { "_BOOL4", e_word_class::e_type },
+            { "_BOOL8", e_word_class::e_type },
+            { "_UNKNOWN", e_word_class::e_type },
+            { "__int8", e_word_class::e_type },
+            { "__int16", e_word_class::e_type },
+            { "__int32", e_word_class::e_type },
+            { "__int64", e_word_class::e_type },
+            { "__int128", e_word_class::e_type },
+            { "__m128", e_word_class::e_type },
+            { "__m128i", e_word_class::e_type },
+            { "__m128d", e_word_class::e_type },
+            { "gcc_va_list", e_word_class::e_type },
+
+            // Windows types
+            { "BYTE", e_word_class::e_type },
+            { "WORD", e_word_class::e_type },
+            { "DWORD", e_word_class::e_type },
+            { "QWORD", e_word_class::e_type },
+            { "DWORD64", e_word_class::e_type },
+            { "BOOL", e_word_class::e_type },
+            { "BOOLEAN", e_word_class::e_type },
+            { "CHAR", e_word_class::e_type },
+            { "UCHAR", e_word_class::e_type },
+            { "WCHAR", e_word_class::e_type },
+            { "SHORT", e_word_class::e_type },
+            { "USHORT", e_word_class::e_type },
+            { "INT", e_word_class::e_type },
+            { "UINT", e_word_class::e_type },
+            { "LONG", e_word_class::e_type },
+            { "ULONG", e_word_class::e_type },
+            { "LONGLONG", e_word_class::e_type },
+            { "ULONGLONG", e_word_class::e_type },
+            { "ULONG_PTR", e_word_class::e_type },
+            { "SIZE_T", e_word_class::e_type },
+            { "NTSTATUS", e_word_class::e_type },
+            { "HRESULT", e_word_class::e_type },
+            { "HANDLE", e_word_class::e_type },
+            { "HWND", e_word_class::e_type },
+            { "HINSTANCE", e_word_class::e_type },
+            { "HMODULE", e_word_class::e_type },
+            { "HKEY", e_word_class::e_type },
+            { "FARPROC", e_word_class::e_type },
+            { "PVOID", e_word_class::e_type },
+            { "LPVOID", e_word_class::e_type },
+            { "LPCVOID", e_word_class::e_type },
+            { "LPBYTE", e_word_class::e_type },
+            { "LPDWORD", e_word_class::e_type },
+            { "LPCSTR", e_word_class::e_type },
+            { "LPSTR", e_word_class::e_type },
+            { "LPCWSTR", e_word_class::e_type },
+            { "LPWSTR", e_word_class::e_type },
+        };
+
+        static_assert( std::size( k_classified_words ) < 255, "slot indices are stored in a byte" );
+
+        // FNV-1a over the word; computed once per lookup, independent of the table seed
+        constexpr std::uint32_t word_hash( std::string_view word ) noexcept {
+            std::uint32_t hash = 2166136261u;
+            for ( const char c : word ) {
+                hash ^= static_cast< std::uint8_t >( c );
+                hash *= 16777619u;
+            }
+            return hash;
+        }
+
+        // seeded finalizer; the seed is picked at compile time so no two words share a slot
+        constexpr std::uint32_t word_slot( std::uint32_t hash, std::uint32_t seed, std::uint32_t mask ) noexcept {
+            hash ^= seed * 0x9e3779b9u;
+            hash ^= hash >> 16;
+            hash *= 0x7feb352du;
+            hash ^= hash >> 15;
+            return hash & mask;
+        }
+
+        struct word_table_t {
+            static constexpr std::uint32_t k_slots = 4096; // power of two; sparse enough that a seed turns up quickly
+            static constexpr std::uint32_t k_mask  = k_slots - 1;
+
+            std::uint32_t                        m_seed { 0 };
+            std::size_t                          m_min_length { 0 };
+            std::size_t                          m_max_length { 0 };
+            std::array< std::uint8_t, k_slots > m_slots { }; // index into k_classified_words + 1, 0 = empty
+        };
+
+        consteval word_table_t build_word_table( ) {
+            constexpr std::size_t k_words = std::size( k_classified_words );
+
+            std::array< std::uint32_t, k_words > hashes { };
+            word_table_t                         table { };
+            table.m_min_length = k_classified_words[ 0 ].m_word.size( );
+
+            for ( std::size_t i = 0; i < k_words; i++ ) {
+                hashes[ i ]        = word_hash( k_classified_words[ i ].m_word );
+                table.m_min_length = std::min( table.m_min_length, k_classified_words[ i ].m_word.size( ) );
+                table.m_max_length = std::max( table.m_max_length, k_classified_words[ i ].m_word.size( ) );
+            }
+
+            for ( std::uint32_t seed = 1; seed < 100000; seed++ ) {
+                std::array< std::uint64_t, word_table_t::k_slots / 64 > used { };
+                bool                                                    collided = false;
+
+                for ( std::size_t i = 0; i < k_words && !collided; i++ ) {
+                    const auto slot = word_slot( hashes[ i ], seed, word_table_t::k_mask );
+                    const auto bit  = std::uint64_t { 1 } << ( slot % 64 );
+
+                    collided         = ( used[ slot / 64 ] & bit ) != 0;
+                    used[ slot / 64 ] |= bit;
+                }
+
+                if ( collided )
+                    continue;
+
+                table.m_seed = seed;
+                for ( std::size_t i = 0; i < k_words; i++ ) {
+                    table.m_slots[ word_slot( hashes[ i ], seed, word_table_t::k_mask ) ] = static_cast< std::uint8_t >( i + 1 );
+                }
+                return table;
+            }
+
+            return table;
+        }
+
+        inline constexpr word_table_t k_word_table = build_word_table( );
+
+        static_assert( k_word_table.m_seed != 0, "no collision-free seed found; grow word_table_t::k_slots" );
+    } // namespace detail
+
+    // Allocation-free keyword/type lookup: a length check, one hash, one table load and one compare.
+    [[nodiscard]] constexpr e_word_class classify_word( std::string_view word ) noexcept {
+        using namespace detail;
+
+        if ( word.size( ) < k_word_table.m_min_length || word.size( ) > k_word_table.m_max_length )
+            return e_word_class::e_none;
+
+        const auto index = k_word_table.m_slots[ word_slot( word_hash( word ), k_word_table.m_seed, word_table_t::k_mask ) ];
+        if ( index == 0 )
+            return e_word_class::e_none;
+
+        const auto &entry = k_classified_words[ index - 1 ];
+        return entry.m_word == word ? entry.m_class : e_word_class::e_none;
+    }
+} // namespace ida_re::utils